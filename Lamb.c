@@ -7,137 +7,156 @@
 #include "parser.h"
 #include "lexer.h"
 #include "interpreter.h"
+#include "budget.h"
+#include "trace.h"
+#include "memo.h"
+#include "spawn.h"
 
-void parse_file(const char* filename)
+void shift(int* argc, char*** argv)
 {
-  FILE *fptr;
-  fptr = fopen(filename, "r");
-  if (fptr == NULL)
-  {
-    fprintf(stderr, "Failed to Open File \n");
-    exit(1);
-  }
-  
-  TokenStream tokens = {0};
-  ExprStream exprs = {0};
-
-  char contents[100];
-  while(fgets(contents, 100, fptr)) {
-    // strip new lines
-    size_t len = strlen(contents);
-    if (len > 0 && contents[len - 1] == '\n')
-    {
-      contents[len-1] = '\0';
-      len--;
-    }
+  if (*argc > 0) (*argc)--;
+  (*argv)++;
+}
 
-    bool is_blank = true;
-    for (size_t i = 0; i < len; ++i) {
-        if (!isspace((unsigned char)contents[i])) {
-            is_blank = false;
-            break;
-        }
-    }
-    if (is_blank) continue;
+void repl()
+{
+  char line[256] = {0};
+  while (1) 
+  {
+    printf("\\>: ");
+    if (!fgets(line, sizeof(line), stdin)) break; // EOF
 
-    TokenStream tokens = tokenise(contents);
-    if (tokens.tokens == NULL)
-    {
-      fprintf(stderr, "Failed to tokenize input\n");
-      continue;
-    }
-    
-    // move tokens to the heap
-    TokenStream* heap_tokens = malloc(sizeof(TokenStream));
-    if (!heap_tokens)
-    {
-      fprintf(stderr, "Memory allocation failed\n");
-      exit(1);
-    }
-    *heap_tokens = tokens;
-    da_append(exprs, heap_tokens);
+    size_t len = strlen(line);
+    if (len > 0 && line[len-1] == '\n') line[len-1] = '\0';
+    interpret_line(line);
   }
-  interpret(&exprs); 
-  fclose(fptr);
-  free_token_stream(&tokens);
 }
 
-void shift(int* argc, char*** argv)
+void usage()
 {
-  if (*argc > 0) (*argc)--; (*argv)++;
+  fprintf(stderr, "Usage: Lamb [-e subst|cek|need|vm|net] [-t threads] [-j jobs] [-p workers] [-f steps] [-w milliseconds] [-m megabytes] [--stats] [--trace file] [--memo entries] [-i inputfile.l]\n");
+  fprintf(stderr, "       Lamb --decode-trace file\n");
 }
 
 int main(int argc, char** argv) 
 {
-  char line[256] = {0};
   const char* input_file = NULL;
+  bool ran_file = false;
   shift(&argc, &argv);
   
-  if (argc == 0) // interpreter mode 
-  {  
-    while (1) 
+  while (argc > 0) 
+  {
+    if (strcmp(argv[0], "-e") == 0 && argc > 1)
+    {
+      EvalMode mode;
+      if (parse_eval_mode(argv[1], &mode)) set_eval_mode(mode);
+      else fprintf(stderr, "Unknown evaluator: %s\n", argv[1]);
+      shift(&argc, &argv);
+      shift(&argc, &argv);
+    }
+    else if (strcmp(argv[0], "-t") == 0 && argc > 1)
+    {
+      int threads = atoi(argv[1]);
+      if (threads > 0) set_eval_threads(threads);
+      else fprintf(stderr, "Invalid thread count: %s\n", argv[1]);
+      shift(&argc, &argv);
+      shift(&argc, &argv);
+    }
+    else if (strcmp(argv[0], "-p") == 0 && argc > 1)
+    {
+      int workers = atoi(argv[1]);
+      if (workers > 0) set_spawn_workers(workers);
+      else fprintf(stderr, "Invalid worker count: %s\n", argv[1]);
+      shift(&argc, &argv);
+      shift(&argc, &argv);
+    }
+    else if (strcmp(argv[0], "-j") == 0 && argc > 1)
     {
-      printf("\\>: ");
-      if (fgets(line, sizeof(line), stdin)) 
+      int jobs = atoi(argv[1]);
+      if (jobs > 0) set_eval_jobs(jobs);
+      else fprintf(stderr, "Invalid job count: %s\n", argv[1]);
+      shift(&argc, &argv);
+      shift(&argc, &argv);
+    }
+    else if ((strcmp(argv[0], "-f") == 0 || strcmp(argv[0], "-w") == 0 || strcmp(argv[0], "-m") == 0) && argc > 1)
+    {
+      // per expression limits, see budget.h
+      char* end;
+      unsigned long limit = strtoul(argv[1], &end, 10);
+      if (*end != '\0' || end == argv[1])
       {
-        size_t len = strlen(line);
-        if (len > 0 && line[len-1] == '\n') line[len-1] = '\0';
-        TokenStream tokens = tokenise(line);
-        if (tokens.tokens == NULL) {
-          fprintf(stderr, "Failed to tokenize input\n");
-          return 1;
-        }
-
-        // heap allocate an expression
-        ExprStream single_expr = {0};
-        TokenStream* heap_tokens = malloc(sizeof(TokenStream));
-        if (!heap_tokens) {
-          fprintf(stderr, "Memory allocation failed\n");
-          exit(1);
-        }
-
-        *heap_tokens = tokens;
-        da_append(single_expr, heap_tokens);
-        
-        interpret(&single_expr);
-            
-        free_token_stream(&tokens);
-        free(heap_tokens);
+        fprintf(stderr, "Invalid limit: %s\n", argv[1]);
+      }
+      else
+      {
+        Budget budget = get_budget();
+        if (argv[0][1] == 'f') budget.steps = limit;
+        else if (argv[0][1] == 'w') budget.time_ms = limit;
+        else budget.memory = (size_t)limit * 1024 * 1024;
+        set_budget(budget);
       }
+      shift(&argc, &argv);
+      shift(&argc, &argv);
     }
-  }
-  else 
-  {
-    while (argc > 0) 
+    else if (strcmp(argv[0], "--stats") == 0)
+    {
+      set_show_stats(true);
+      shift(&argc, &argv);
+    }
+    else if (strcmp(argv[0], "--memo") == 0 && argc > 1)
+    {
+      char* end;
+      unsigned long entries = strtoul(argv[1], &end, 10);
+      if (*end != '\0' || end == argv[1]) fprintf(stderr, "Invalid memo size: %s\n", argv[1]);
+      else set_memo_capacity(entries);
+      shift(&argc, &argv);
+      shift(&argc, &argv);
+    }
+    else if (strcmp(argv[0], "--trace") == 0 && argc > 1)
     {
-      if (strcmp(argv[0], "-i") == 0 && argc > 1)
+      if (!trace_open(argv[1])) fprintf(stderr, "Could not open trace file: %s\n", argv[1]);
+      shift(&argc, &argv);
+      shift(&argc, &argv);
+    }
+    else if (strcmp(argv[0], "--decode-trace") == 0 && argc > 1)
+    {
+      if (!trace_decode(argv[1], stdout)) fprintf(stderr, "Not a trace file: %s\n", argv[1]);
+      return 0;
+    }
+    else if (strcmp(argv[0], "-i") == 0 && argc > 1)
+    {
+      input_file = argv[1];
+      shift(&argc, &argv);
+      shift(&argc, &argv);
+      ran_file = true;
+      if (str_ends_with(input_file, ".l"))
+      {
+        interpret_file(input_file);
+      }
+      else 
+      {
+        fprintf(stderr, "File should be a .l file\n");
+      }
+    }
+    else 
+    {
+      if (argc < 2 && (strcmp(argv[0], "-i") == 0 || strcmp(argv[0], "-e") == 0 || strcmp(argv[0], "-t") == 0 ||
+                       strcmp(argv[0], "-j") == 0 || strcmp(argv[0], "-p") == 0 || strcmp(argv[0], "-f") == 0 ||
+                       strcmp(argv[0], "-w") == 0 || strcmp(argv[0], "-m") == 0 ||
+                       strcmp(argv[0], "--trace") == 0 || strcmp(argv[0], "--decode-trace") == 0 ||
+                       strcmp(argv[0], "--memo") == 0))
       {
-        input_file = argv[1];
-        shift(&argc, &argv);
-        shift(&argc, &argv);
-        if (str_ends_with(input_file, ".l"))
-        {
-          set_current_file_path(input_file);
-          parse_file(input_file);
-        }
-        else 
-        {
-          fprintf(stderr, "File should be a .l file\n");
-        }
+        fprintf(stderr, "Missing value after %s\n", argv[0]);
       }
       else 
       {
-        if (strcmp(argv[0], "-i") == 0 && argc < 2)
-        {
-          fprintf(stderr, "Missing input file after -i\n");
-        }
-        else 
-        {
-          fprintf(stderr, "Unknown Argument: %s\n", argv[0]);
-          shift(&argc, &argv);
-        }
+        fprintf(stderr, "Unknown Argument: %s\n", argv[0]);
       }
+      usage();
+      shift(&argc, &argv);
     }
   }
+
+  if (!ran_file) repl(); // interpreter mode
   return 0;
 }
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+
+#include "arena.h"
+
+static ArenaChunk* new_chunk(size_t capacity, ArenaChunk* next)
+{
+    ArenaChunk* chunk = malloc(sizeof(ArenaChunk) + capacity);
+    if (!chunk) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    chunk->next = next;
+    chunk->capacity = capacity;
+    chunk->used = 0;
+    return chunk;
+}
+
+void* arena_alloc(Arena* arena, size_t size)
+{
+    const size_t align = alignof(max_align_t);
+    size = (size + align - 1) & ~(align - 1);
+    arena->allocations++;
+
+    ArenaChunk* chunk = arena->head;
+    if (!chunk || chunk->used + size > chunk->capacity) {
+        size_t capacity = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        chunk = new_chunk(capacity, arena->head);
+        arena->head = chunk;
+        arena->size += capacity;
+    }
+
+    void* ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+char* arena_strdup(Arena* arena, const char* s)
+{
+    return arena_strndup(arena, s, strlen(s));
+}
+
+char* arena_strndup(Arena* arena, const char* s, size_t len)
+{
+    char* out = arena_alloc(arena, len + 1);
+    memcpy(out, s, len);
+    out[len] = '\0';
+    return out;
+}
+
+void arena_reset(Arena* arena)
+{
+    if (!arena->head) return;
+
+    // keep the oldest chunk, it is usually enough for the next expression
+    ArenaChunk* chunk = arena->head;
+    while (chunk->next) {
+        ArenaChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    chunk->used = 0;
+    arena->head = chunk;
+    arena->size = chunk->capacity;
+}
+
+void arena_free(Arena* arena)
+{
+    ArenaChunk* chunk = arena->head;
+    while (chunk) {
+        ArenaChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+    arena->size = 0;
+}
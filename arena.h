@@ -0,0 +1,28 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+// Bump pointer region, grows by chaining chunks and is released in one go
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;
+    size_t capacity;
+    size_t used;
+    char data[];
+} ArenaChunk;
+
+typedef struct {
+    ArenaChunk* head;
+    size_t size;        // bytes held by all chunks
+    size_t allocations; // arena_alloc calls, kept across resets
+} Arena;
+
+void* arena_alloc(Arena* arena, size_t size);
+char* arena_strdup(Arena* arena, const char* s);
+char* arena_strndup(Arena* arena, const char* s, size_t len);
+void arena_reset(Arena* arena);   // drop everything but keep one chunk for reuse
+void arena_free(Arena* arena);
+
+#endif // ARENA_H
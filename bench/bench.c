@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "../interpreter.h"
+#include "../budget.h"
+#include "../spawn.h"
+
+/*
+ * Benchmark harness for the evaluators.
+ *
+ * Every case loads definitions from a corpus file in bench/ and evaluates
+ * one expression. Each run happens in a forked child so peak RSS belongs to
+ * that case alone. Results are printed as JSON, one case per line, and can
+ * be compared against a stored baseline:
+ *
+ *   ./Bench -e subst -e cek > ../bench/baseline.json
+ *   ./Bench -e subst -e cek -b ../bench/baseline.json
+ */
+
+typedef struct {
+    const char* name;
+    const char* file;   // corpus file with the definitions
+    const char* expr;
+} BenchCase;
+
+static const BenchCase cases[] = {
+    { "fact-7",           "fact.l",      "(FACT SEVEN)" },
+    { "fact-9",           "fact.l",      "(FACT NINE)" },
+    { "fib-15",           "fib.l",       "(FIB FIFTEEN)" },
+    { "fib-20",           "fib.l",       "(FIB TWENTY)" },
+    { "ackermann-2-3",    "ackermann.l", "(ACK TWO THREE)" },
+    { "ackermann-3-3",    "ackermann.l", "(ACK THREE THREE)" },
+    { "eq-50",            "eq.l",        "(EQ FIFTY FIFTY)" },
+    { "eq-100",           "eq.l",        "(EQ HUNDRED HUNDRED)" },
+    { "eq-200",           "eq.l",        "(EQ TWO_HUNDRED TWO_HUNDRED)" },
+    { "deep-binders-200", "deep.l",      "(NEST TWO_HUNDRED)" },
+    { "deep-pairs-1k",    "deep.l",      "(CHAIN THOUSAND)" },
+    { "fib-lucas-pair",   "par.l",       "(BOTH (CHAIN THOUSAND))" },
+};
+
+#define CASE_COUNT (sizeof(cases) / sizeof(cases[0]))
+#define MAX_MODES 8
+
+typedef struct {
+    double wall_ms;
+    unsigned long steps;
+    size_t allocations;
+    long peak_rss_kb;
+    bool stopped;       // a limit tripped
+} Sample;
+
+typedef struct {
+    char name[64];
+    char mode[16];
+    double wall_ms;
+    unsigned long steps;
+} Baseline;
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int compare_ms(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Runs in the child: load the corpus file, time the expression alone
+static void run_case(const BenchCase* c, const char* dir, EvalMode mode, int workers, int out)
+{
+    int null = open("/dev/null", O_WRONLY);
+    if (null >= 0) dup2(null, STDOUT_FILENO); // only the measurements matter
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, c->file);
+    set_eval_mode(mode);
+    if (workers > 0) set_spawn_workers(workers);
+    interpret_file(path);
+
+    unsigned long steps = budget_steps();
+    size_t allocations = eval_allocations();
+    double start = now_ms();
+    interpret_line(c->expr);
+
+    Sample sample = {
+        .wall_ms = now_ms() - start,
+        .steps = budget_steps() - steps,
+        .allocations = eval_allocations() - allocations,
+        .stopped = budget_tripped() != LIMIT_NONE,
+    };
+    fflush(stdout);
+    if (write(out, &sample, sizeof(sample)) != sizeof(sample)) _exit(1);
+    _exit(0);
+}
+
+static bool measure(const BenchCase* c, const char* dir, EvalMode mode, int workers, Sample* sample)
+{
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        run_case(c, dir, mode, workers, fds[1]);
+    }
+    close(fds[1]);
+
+    bool ok = read(fds[0], sample, sizeof(*sample)) == sizeof(*sample);
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = false;
+    sample->peak_rss_kb = usage.ru_maxrss;
+    return ok;
+}
+
+static size_t read_baseline(const char* path, Baseline** out)
+{
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Could not open baseline %s\n", path);
+        exit(1);
+    }
+
+    size_t count = 0, capacity = 0;
+    Baseline* entries = NULL;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        Baseline b;
+        char* name = strstr(line, "\"name\": \"");
+        char* mode = strstr(line, "\"mode\": \"");
+        char* wall = strstr(line, "\"wall_ms\": ");
+        char* steps = strstr(line, "\"steps\": ");
+        if (!name || !mode || !wall || !steps) continue;
+        if (sscanf(name, "\"name\": \"%63[^\"]", b.name) != 1) continue;
+        if (sscanf(mode, "\"mode\": \"%15[^\"]", b.mode) != 1) continue;
+        b.wall_ms = strtod(wall + strlen("\"wall_ms\": "), NULL);
+        b.steps = strtoul(steps + strlen("\"steps\": "), NULL, 10);
+
+        if (count == capacity) {
+            capacity = capacity == 0 ? 32 : capacity * 2;
+            entries = realloc(entries, capacity * sizeof(Baseline));
+            if (!entries) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+        }
+        entries[count++] = b;
+    }
+    fclose(f);
+    *out = entries;
+    return count;
+}
+
+static const Baseline* find_baseline(const Baseline* entries, size_t count, const char* name, const char* mode)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(entries[i].name, name) == 0 && strcmp(entries[i].mode, mode) == 0) return &entries[i];
+    }
+    return NULL;
+}
+
+// Wall time is noisy, a case only regresses past the tolerance and by more
+// than this many milliseconds. Step counts are exact and compared as such.
+#define NOISE_FLOOR_MS 2.0
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: Bench [-e subst|cek|need|vm|net]... [-d corpus_dir] [-r runs] [-w milliseconds] [-p workers] [-b baseline.json] [-x tolerance_percent] [case ...]\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* mode_names[MAX_MODES];
+    EvalMode modes[MAX_MODES];
+    int mode_count = 0;
+    const char* dir = "../bench";
+    const char* baseline_path = NULL;
+    const char* only[CASE_COUNT];
+    int only_count = 0;
+    int runs = 5;
+    int workers = 0;
+    double tolerance = 10.0;
+    Budget budget = { .time_ms = 60000 };
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-e") == 0 && has_value) {
+            if (mode_count == MAX_MODES || !parse_eval_mode(argv[i + 1], &modes[mode_count])) {
+                fprintf(stderr, "Unknown evaluator: %s\n", argv[i + 1]);
+                return 1;
+            }
+            mode_names[mode_count++] = argv[++i];
+        } else if (strcmp(argv[i], "-d") == 0 && has_value) {
+            dir = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && has_value) {
+            runs = atoi(argv[++i]);
+            if (runs < 1) runs = 1;
+        } else if (strcmp(argv[i], "-w") == 0 && has_value) {
+            budget.time_ms = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-p") == 0 && has_value) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && has_value) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "-x") == 0 && has_value) {
+            tolerance = strtod(argv[++i], NULL);
+        } else if (argv[i][0] != '-' && only_count < (int)CASE_COUNT) {
+            only[only_count++] = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (mode_count == 0) {
+        modes[0] = EVAL_SUBST;
+        mode_names[0] = "subst";
+        mode_count = 1;
+    }
+    set_budget(budget); // a runaway case is cut off instead of stalling the run
+    double* walls = malloc(runs * sizeof(double));
+
+    Baseline* baseline = NULL;
+    size_t baseline_count = baseline_path ? read_baseline(baseline_path, &baseline) : 0;
+    int regressions = 0;
+    bool first = true;
+
+    printf("[\n");
+    for (size_t c = 0; c < CASE_COUNT; c++) {
+        bool selected = only_count == 0;
+        for (int i = 0; i < only_count; i++) selected |= strcmp(only[i], cases[c].name) == 0;
+        if (!selected) continue;
+
+        for (int m = 0; m < mode_count; m++) {
+            // median run for time, largest for memory
+            Sample best = {0};
+            int done = 0;
+            bool ok = true;
+            for (int r = 0; r < runs && ok; r++) {
+                Sample sample;
+                ok = measure(&cases[c], dir, modes[m], workers, &sample);
+                if (!ok) break;
+                long rss = best.peak_rss_kb;
+                best = sample;
+                if (rss > best.peak_rss_kb) best.peak_rss_kb = rss;
+                walls[done++] = sample.wall_ms;
+                if (sample.stopped) break; // hit the time limit, no point repeating
+            }
+            if (ok) {
+                qsort(walls, done, sizeof(double), compare_ms);
+                best.wall_ms = done % 2 ? walls[done / 2] : (walls[done / 2 - 1] + walls[done / 2]) / 2;
+            }
+            if (!ok) {
+                fprintf(stderr, "%s (%s): run failed\n", cases[c].name, mode_names[m]);
+                regressions++;
+                continue;
+            }
+
+            double per_sec = best.wall_ms > 0 ? best.steps / (best.wall_ms / 1000.0) : 0;
+            printf("%s  {\"name\": \"%s\", \"mode\": \"%s\", \"wall_ms\": %.3f, \"steps\": %lu, \"steps_per_sec\": %.0f, "
+                   "\"allocations\": %zu, \"peak_rss_kb\": %ld, \"completed\": %s}",
+                   first ? "" : ",\n", cases[c].name, mode_names[m], best.wall_ms, best.steps, per_sec,
+                   best.allocations, best.peak_rss_kb, best.stopped ? "false" : "true");
+            fflush(stdout);
+            first = false;
+
+            const Baseline* base = find_baseline(baseline, baseline_count, cases[c].name, mode_names[m]);
+            if (!base) continue;
+            bool slower = best.wall_ms > base->wall_ms * (1.0 + tolerance / 100.0) &&
+                          best.wall_ms - base->wall_ms > NOISE_FLOOR_MS;
+            if (slower || best.steps > base->steps) {
+                fprintf(stderr, "REGRESSION %s (%s): %.3f ms, %lu steps (baseline %.3f ms, %lu steps)\n",
+                        cases[c].name, mode_names[m], best.wall_ms, best.steps, base->wall_ms, base->steps);
+                regressions++;
+            }
+        }
+    }
+    printf("\n]\n");
+
+    free(walls);
+    free(baseline);
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+#include <stdatomic.h>
+#include <time.h>
+
+#include "budget.h"
+
+static Budget budget = {0};
+static Region* measured = NULL;
+static struct timespec started;
+static atomic_ulong steps;
+static unsigned long total_steps;
+static atomic_size_t charged;
+static atomic_int tripped;
+
+void set_budget(Budget limits)
+{
+    budget = limits;
+}
+
+Budget get_budget(void)
+{
+    return budget;
+}
+
+void budget_start(Region* region)
+{
+    measured = region;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    total_steps += atomic_exchange(&steps, 0);
+    atomic_store(&charged, 0);
+    atomic_store(&tripped, LIMIT_NONE);
+}
+
+static bool trip(Limit limit)
+{
+    int none = LIMIT_NONE;
+    atomic_compare_exchange_strong(&tripped, &none, limit); // keep the first one
+    return false;
+}
+
+static unsigned long elapsed_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)(now.tv_sec - started.tv_sec) * 1000 + (now.tv_nsec - started.tv_nsec) / 1000000;
+}
+
+static size_t memory_used(void)
+{
+    size_t bytes = atomic_load(&charged);
+    if (measured) bytes += region_size(measured);
+    return bytes;
+}
+
+bool budget_spend(void)
+{
+    if (atomic_load_explicit(&tripped, memory_order_relaxed) != LIMIT_NONE) return false;
+
+    unsigned long n = atomic_fetch_add_explicit(&steps, 1, memory_order_relaxed) + 1;
+    if (budget.steps && n > budget.steps) return trip(LIMIT_STEPS);
+    if (n % BUDGET_CHECK_INTERVAL != 0) return true;
+
+    if (budget.time_ms && elapsed_ms() >= budget.time_ms) return trip(LIMIT_TIME);
+    if (budget.memory && memory_used() > budget.memory) return trip(LIMIT_MEMORY);
+    return true;
+}
+
+bool budget_absorb(unsigned long spent)
+{
+    if (atomic_load(&tripped) != LIMIT_NONE) return false;
+
+    unsigned long n = atomic_fetch_add(&steps, spent) + spent;
+    if (budget.steps && n > budget.steps) return trip(LIMIT_STEPS);
+    return true;
+}
+
+void budget_charge(size_t bytes)
+{
+    atomic_fetch_add(&charged, bytes);
+}
+
+unsigned long budget_steps(void)
+{
+    return total_steps + atomic_load(&steps);
+}
+
+Limit budget_tripped(void)
+{
+    return atomic_load(&tripped);
+}
+
+const char* limit_message(Limit limit)
+{
+    switch (limit) {
+        case LIMIT_STEPS:  return "Step limit reached, evaluation stopped";
+        case LIMIT_TIME:   return "Time limit reached, evaluation stopped";
+        case LIMIT_MEMORY: return "Memory limit reached, evaluation stopped";
+        case LIMIT_NONE:
+        default:           return "No limit reached";
+    }
+}
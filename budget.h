@@ -0,0 +1,57 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parser.h"
+
+/*
+ * Resource limits for one top-level expression.
+ *
+ * Every evaluator spends one unit of fuel per reduction step (a beta or
+ * delta step, or an interaction in the net) and stops with a NULL result
+ * once a limit has tripped. Elapsed time and the memory of the expression's
+ * region are sampled every BUDGET_CHECK_INTERVAL steps. A limit of 0 means
+ * no limit.
+ */
+
+typedef enum {
+    LIMIT_NONE,
+    LIMIT_STEPS,
+    LIMIT_TIME,
+    LIMIT_MEMORY,
+} Limit;
+
+typedef struct {
+    unsigned long steps;
+    unsigned long time_ms;
+    size_t memory;         // bytes
+} Budget;
+
+// One substitution step can grow a term a lot, so memory is sampled often
+// enough that -m is not overshot by much. Reading the clock and the region
+// size is cheap next to 64 steps.
+#define BUDGET_CHECK_INTERVAL 64
+
+void set_budget(Budget budget);
+Budget get_budget(void);
+
+// Start counting for an expression whose terms are allocated in region
+void budget_start(Region* region);
+
+// Spend one step, false once any limit has tripped. Safe to call from
+// several threads.
+bool budget_spend(void);
+
+// Account memory allocated outside the region
+void budget_charge(size_t bytes);
+
+// Add steps spent elsewhere, e.g. by a forked worker, false once a limit has tripped
+bool budget_absorb(unsigned long spent);
+
+Limit budget_tripped(void);
+unsigned long budget_steps(void); // steps spent by every expression so far
+const char* limit_message(Limit limit);
+
+#endif // BUDGET_H
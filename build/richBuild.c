@@ -3,8 +3,9 @@
 
 // -DLOGGING flag for logging enable
 // -DLOGTREES flag for logging trees
-#define cflags "-DLOGGING -Wall"
+#define cflags "-O2 -Wall -pthread"
 #define executable_name "Lamb"
+#define bench_name "Bench"
 
 void BUILD_PROJECT() {
   char* files = READ_FILES("../");
@@ -12,7 +13,17 @@ void BUILD_PROJECT() {
   CLEANUP();
 }
 
-int main() {
-  BUILD_PROJECT();
+// the harness in bench/ links the interpreter in place of Lamb.c
+void BUILD_BENCH() {
+  char* files = READ_FILES("../");
+  str_remove(&files, "../Lamb.c ");
+  strcat(files, "../bench/bench.c");
+  COMPILE("gcc", files, cflags, bench_name, NULL);
+  CLEANUP();
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) BUILD_BENCH();
+  else BUILD_PROJECT();
   return 0;
 }
@@ -158,7 +158,7 @@ void exclude_files(char** files, int size, ...) {
 }
 
 void compile_files(char* compiler, const char* files, const char* cflags, char* executable_name, char* packages) {
-  char compile_command[256];
+  char compile_command[4096];
 
   if (packages == NULL) {
     snprintf(compile_command, sizeof(compile_command),
@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bytecode.h"
+#include "stack.h"
+
+typedef enum {
+    COMPILE_NODE,   // compile a subterm
+    COMPILE_EMIT,   // emit a single opcode
+    COMPILE_PATCH,  // the closure body at `operand` is complete, store its length
+} CompileKind;
+
+typedef struct {
+    CompileKind kind;
+    Expr* node;
+    int32_t operand;
+    bool tail;
+} CompileFrame;
+
+static struct { CompileFrame* items; size_t count; size_t capacity; } compile_work = {0};
+
+static int32_t find_compiled(Chunk* chunk, Expr* expr)
+{
+    if (chunk->compiled_capacity == 0) return -1;
+    size_t mask = chunk->compiled_capacity - 1;
+    for (size_t i = expr->hash & mask; chunk->compiled_terms[i]; i = (i + 1) & mask) {
+        if (chunk->compiled_terms[i] == expr) return chunk->compiled_offsets[i];
+    }
+    return -1;
+}
+
+static void remember_compiled(Chunk* chunk, Expr* expr, int32_t offset)
+{
+    if ((chunk->compiled_count + 1) * 2 > chunk->compiled_capacity) {
+        size_t capacity = chunk->compiled_capacity == 0 ? 64 : chunk->compiled_capacity * 2;
+        Expr** terms = calloc(capacity, sizeof(Expr*));
+        int32_t* offsets = calloc(capacity, sizeof(int32_t));
+        if (!terms || !offsets) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        for (size_t i = 0; i < chunk->compiled_capacity; i++) {
+            Expr* term = chunk->compiled_terms[i];
+            if (!term) continue;
+            size_t j = term->hash & (capacity - 1);
+            while (terms[j]) j = (j + 1) & (capacity - 1);
+            terms[j] = term;
+            offsets[j] = chunk->compiled_offsets[i];
+        }
+        free(chunk->compiled_terms);
+        free(chunk->compiled_offsets);
+        chunk->compiled_terms = terms;
+        chunk->compiled_offsets = offsets;
+        chunk->compiled_capacity = capacity;
+    }
+
+    size_t mask = chunk->compiled_capacity - 1;
+    size_t i = expr->hash & mask;
+    while (chunk->compiled_terms[i]) i = (i + 1) & mask;
+    chunk->compiled_terms[i] = expr;
+    chunk->compiled_offsets[i] = offset;
+    chunk->compiled_count++;
+}
+
+static void emit(Chunk* chunk, int32_t word)
+{
+    stack_push(chunk->code, word);
+}
+
+int32_t compile_term(Chunk* chunk, Expr* expr)
+{
+    int32_t existing = find_compiled(chunk, expr);
+    if (existing >= 0) return existing;
+
+    int32_t entry = (int32_t)chunk->code.count;
+    size_t base = compile_work.count;
+    stack_push(compile_work, ((CompileFrame){ COMPILE_EMIT, NULL, OP_RETURN, false }));
+    stack_push(compile_work, ((CompileFrame){ COMPILE_NODE, expr, 0, true }));
+
+    while (compile_work.count > base) {
+        CompileFrame frame = stack_pop(compile_work);
+
+        if (frame.kind == COMPILE_EMIT) {
+            emit(chunk, frame.operand);
+            continue;
+        }
+        if (frame.kind == COMPILE_PATCH) {
+            // length of the body that follows the 3 word CLOSURE instruction
+            chunk->code.items[frame.operand + 2] = (int32_t)chunk->code.count - (frame.operand + 3);
+            continue;
+        }
+
+        Expr* node = frame.node;
+        switch (node->type) {
+            case EXPR_VAR:
+                if (node->var.index >= 0) {
+                    emit(chunk, OP_ACCESS);
+                    emit(chunk, node->var.index);
+                } else {
+                    emit(chunk, OP_GLOBAL);
+                    emit(chunk, (int32_t)node->var.name);
+                }
+                break;
+            case EXPR_ABS:
+            {
+                int32_t at = (int32_t)chunk->code.count;
+                stack_push(chunk->abstractions, node);
+                emit(chunk, OP_CLOSURE);
+                emit(chunk, (int32_t)chunk->abstractions.count - 1);
+                emit(chunk, 0); // patched once the body is compiled
+                stack_push(compile_work, ((CompileFrame){ COMPILE_PATCH, NULL, at, false }));
+                stack_push(compile_work, ((CompileFrame){ COMPILE_EMIT, NULL, OP_RETURN, false }));
+                stack_push(compile_work, ((CompileFrame){ COMPILE_NODE, abs_body(node), 0, true }));
+                break;
+            }
+            case EXPR_APP:
+            {
+                int32_t op = frame.tail ? OP_TAILAPPLY : OP_APPLY;
+                stack_push(compile_work, ((CompileFrame){ COMPILE_EMIT, NULL, op, false }));
+                stack_push(compile_work, ((CompileFrame){ COMPILE_NODE, app_arg(node), 0, false }));
+                stack_push(compile_work, ((CompileFrame){ COMPILE_NODE, app_func(node), 0, false }));
+                break;
+            }
+            default:
+                fprintf(stderr, "Cannot compile expression type %d\n", node->type);
+                exit(1);
+        }
+    }
+
+    remember_compiled(chunk, expr, entry);
+    return entry;
+}
+
+void reset_chunk(Chunk* chunk)
+{
+    chunk->code.count = 0;
+    chunk->abstractions.count = 0;
+    if (chunk->compiled_terms) {
+        memset(chunk->compiled_terms, 0, chunk->compiled_capacity * sizeof(Expr*));
+    }
+    chunk->compiled_count = 0;
+}
+
+void disassemble(Chunk* chunk)
+{
+    size_t pc = 0;
+    while (pc < chunk->code.count) {
+        int32_t* code = chunk->code.items;
+        printf("%04zu ", pc);
+        switch (code[pc]) {
+            case OP_ACCESS:    printf("ACCESS %d\n", code[pc + 1]); pc += 2; break;
+            case OP_CLOSURE:   printf("CLOSURE #%d len %d\n", code[pc + 1], code[pc + 2]); pc += 3; break;
+            case OP_GLOBAL:    printf("GLOBAL %s\n", symbol_name((Symbol)code[pc + 1])); pc += 2; break;
+            case OP_APPLY:     printf("APPLY\n"); pc += 1; break;
+            case OP_TAILAPPLY: printf("TAILAPPLY\n"); pc += 1; break;
+            case OP_RETURN:    printf("RETURN\n"); pc += 1; break;
+            default:           printf("?? %d\n", code[pc]); pc += 1; break;
+        }
+    }
+}
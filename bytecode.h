@@ -0,0 +1,48 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdint.h>
+
+#include "parser.h"
+
+/*
+ * Linear bytecode for the VM (vm.h). Each instruction is an opcode word
+ * followed by its operands:
+ *
+ *   ACCESS n            push the value of De Bruijn index n
+ *   CLOSURE abs len     push a closure over the next len words (the body)
+ *   GLOBAL sym          push the value of a global definition
+ *   APPLY               pop an argument and a function and call it
+ *   TAILAPPLY           APPLY in tail position, reuses the current frame
+ *   RETURN              return the top of the stack to the caller
+ *
+ * `abs` indexes the abstraction a closure was compiled from, used to name
+ * its binder on read back.
+ */
+typedef enum {
+    OP_ACCESS,
+    OP_CLOSURE,
+    OP_GLOBAL,
+    OP_APPLY,
+    OP_TAILAPPLY,
+    OP_RETURN,
+} OpCode;
+
+typedef struct {
+    struct { int32_t* items; size_t count; size_t capacity; } code;
+    struct { Expr** items; size_t count; size_t capacity; } abstractions;
+
+    // code offset of every term compiled on its own (top level and globals)
+    Expr** compiled_terms;
+    int32_t* compiled_offsets;
+    size_t compiled_capacity;
+    size_t compiled_count;
+} Chunk;
+
+// Compile a closed term (once per chunk) into a block ending in RETURN,
+// returns the offset of its first instruction
+int32_t compile_term(Chunk* chunk, Expr* expr);
+void reset_chunk(Chunk* chunk);
+void disassemble(Chunk* chunk);
+
+#endif // BYTECODE_H
@@ -1,57 +1,212 @@
 #include "debug.h"
+#include "interpreter.h"
+#include "numeral.h"
+#include "stack.h"
+#include "stats.h"
+#include "trace.h"
 
-#ifdef LOGGING
+// Count every step for --stats and --trace, print it too when built with LOGGING.
+// expr is NULL for a step that has no term, such as an interaction in the net
 void log_reduction(ReductionType type, const char* label, Expr* expr)
 {
+    switch (type) {
+        case REDUCTION_BETA: stats.beta++; break;
+        case REDUCTION_DELTA: stats.delta++; break;
+        case CONVERSION_ALPHA: stats.alpha++; break;
+        case REDUCTION_ETA: stats.eta++; break;
+        case REDUCTION_ARITH: stats.arith++; break;
+        default: break;
+    }
+    if (trace_enabled && type != REDUCTION_NONE) trace_event(type, expr);
+
+#ifdef LOGGING
     const char* prefix = "";
     switch(type) {
         case REDUCTION_BETA: prefix = "β> "; break;
         case REDUCTION_DELTA: prefix = "δ> "; break;
         case CONVERSION_ALPHA: prefix = "α> "; break;
         case REDUCTION_ETA: prefix = "η> "; break;
+        case REDUCTION_ARITH: prefix = "+> "; break;
         default: prefix = ">"; break;
     }
     printf("%s%s ", prefix, label);
-    print_expr(expr);
+    if (expr) print_expr(expr); // the net has no term for its steps
     printf("\n");
+#endif
 }
-#else 
-void log_reduction(ReductionType type, const char* label, Expr* expr)
+
+
+
+static struct { const Expr** items; size_t count; size_t capacity; } scan_work = {0};
+
+// Does a free (global) variable called `name` occur in expr
+static bool global_in(const Expr* expr, Symbol name)
 {
+    size_t base = scan_work.count;
+    stack_push(scan_work, expr);
+
+    while (scan_work.count > base) {
+        const Expr* node = stack_pop(scan_work);
+        switch (node->type) {
+            case EXPR_VAR:
+                if (node->var.index < 0 && node->var.name == name) {
+                    scan_work.count = base;
+                    return true;
+                }
+                break;
+            case EXPR_ABS:
+                stack_push(scan_work, abs_body(node));
+                break;
+            case EXPR_APP:
+                stack_push(scan_work, app_arg(node));
+                stack_push(scan_work, app_func(node));
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
 }
-#endif
 
+// Globals of the term being printed, gathered once so that most binders
+// are cleared without walking their body
+static struct { Symbol* items; size_t count; size_t capacity; } print_globals = {0};
+
+static void collect_globals(const Expr* expr)
+{
+    size_t base = scan_work.count;
+    print_globals.count = 0;
+    stack_push(scan_work, expr);
+
+    while (scan_work.count > base) {
+        const Expr* node = stack_pop(scan_work);
+        switch (node->type) {
+            case EXPR_VAR:
+            {
+                if (node->var.index >= 0) break;
+                bool seen = false;
+                for (size_t i = 0; i < print_globals.count && !seen; i++) seen = print_globals.items[i] == node->var.name;
+                if (!seen) stack_push(print_globals, node->var.name);
+                break;
+            }
+            case EXPR_ABS:
+                stack_push(scan_work, abs_body(node));
+                break;
+            case EXPR_APP:
+                stack_push(scan_work, app_arg(node));
+                stack_push(scan_work, app_func(node));
+                break;
+            case EXPR_DEF:
+                stack_push(scan_work, node->def.value);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static bool name_clash(const Expr* body, Symbol name)
+{
+    for (size_t i = 0; i < print_globals.count; i++) {
+        if (print_globals.items[i] == name) return global_in(body, name);
+    }
+    return false;
+}
+
+// Choose a printable name for the binder `abs` whose enclosing binders are
+// names[0..depth-1], appending `_` while the hint would capture a variable.
+// Outer binders are checked against the free indices cached on the body.
+static Symbol binder_name(const Expr* abs, Symbol* names, int depth)
+{
+    Symbol name = abs->abs.param;
+    Expr* body = abs_body(abs);
+
+    bool clash = true;
+    while (clash) {
+        clash = name_clash(body, name);
+        for (int i = 0; i < depth && !clash; i++) {
+            clash = names[i] == name && is_free_in(depth - i, body);
+        }
+        if (clash) {
+            char renamed[256];
+            snprintf(renamed, sizeof(renamed), "%s_", symbol_name(name));
+            name = intern_cstr(renamed);
+            stats.alpha++;
+        }
+    }
+    return name;
+}
 
+// Pending output: a subterm at some binder depth, or literal text
+typedef struct {
+    const Expr* node;
+    const char* text;
+    int depth;
+} PrintFrame;
 
+static struct { PrintFrame* items; size_t count; size_t capacity; } print_work = {0};
+static struct { Symbol* items; size_t count; size_t capacity; } print_names = {0};
+
+// Print an expression, restoring variable names from the binder hints
 void print_expr(const Expr* expr)
 {
     if (!expr) return;
 
-    switch (expr->type) {
-        case EXPR_VAR:
-            printf("%s", expr->var.name);
-            break;
-        case EXPR_ABS:
-            printf("(λ%s.", expr->abs.param);
-            print_expr(expr->abs.body);
-            printf(")");
-            break;
-        case EXPR_DEF:
-            printf("%s := ", expr->def.name);
-            print_expr(expr->def.value);
-            break;
-        case EXPR_APP:
-            printf("(");
-            print_expr(expr->app.func);
-            printf(" ");
-            print_expr(expr->app.arg);
-            printf(")");
-            break;
-        case EXPR_IMPORT:
-            //printf("#import <");
-            //printf("%s", expr->impt.filename);
-            //printf(">");
-            break;
+    collect_globals(expr);
+    size_t base = print_work.count;
+    stack_push(print_work, ((PrintFrame){ expr, NULL, 0 }));
+
+    while (print_work.count > base) {
+        PrintFrame frame = stack_pop(print_work);
+        if (frame.text) {
+            printf("%s", frame.text);
+            continue;
+        }
+
+        // binders deeper than this node belong to subterms already printed
+        int depth = frame.depth;
+        print_names.count = depth;
+        const Expr* node = frame.node;
+
+        switch (node->type) {
+            case EXPR_VAR:
+                if (node->var.index < 0) printf("%s", symbol_name(node->var.name));
+                else if (node->var.index < depth) printf("%s", symbol_name(print_names.items[depth - 1 - node->var.index]));
+                else printf("#%d", node->var.index - depth); // dangling, only seen in logs
+                break;
+            case EXPR_NUM:
+            case EXPR_ABS:
+            {
+                unsigned long n;
+                if (numeral_value(node, &n) && n > 0) {
+                    printf("%lu", n);
+                    break;
+                }
+                if (node->type == EXPR_NUM) node = numeral_term(node);
+                Symbol name = binder_name(node, print_names.items, depth);
+                stack_push(print_names, name);
+                printf("(λ%s.", symbol_name(name));
+                stack_push(print_work, ((PrintFrame){ NULL, ")", depth }));
+                stack_push(print_work, ((PrintFrame){ abs_body(node), NULL, depth + 1 }));
+                break;
+            }
+            case EXPR_DEF:
+                printf("%s := ", symbol_name(node->def.name));
+                stack_push(print_work, ((PrintFrame){ node->def.value, NULL, depth }));
+                break;
+            case EXPR_APP:
+                printf("(");
+                stack_push(print_work, ((PrintFrame){ NULL, ")", depth }));
+                stack_push(print_work, ((PrintFrame){ app_arg(node), NULL, depth }));
+                stack_push(print_work, ((PrintFrame){ NULL, " ", depth }));
+                stack_push(print_work, ((PrintFrame){ app_func(node), NULL, depth }));
+                break;
+            case EXPR_IMPORT:
+                //printf("#import <");
+                //printf("%s", expr->impt.filename);
+                //printf(">");
+                break;
+        }
     }
 }
 
@@ -77,23 +232,31 @@ int print_expr_debug(const Expr* expr, int indent)
             //print_indent(indent, '-', "IMPORT", (char*)expr->impt.filename);
             break;
         case EXPR_VAR:
-            print_indent(indent, '-' ,"VAR", expr->var.name);
+        {
+            char index[16];
+            snprintf(index, sizeof(index), "%d", expr->var.index);
+            print_indent(indent, '-' ,"VAR", expr->var.index < 0 ? (char*)symbol_name(expr->var.name) : index);
+            break;
+        }
+
+        case EXPR_NUM:
+            printf("|%*sNUM: %lu\n", indent, "", expr->num.value);
             break;
 
         case EXPR_ABS:
-            print_indent(indent, '-', "ABS λ", expr->abs.param);
-            print_expr_debug(expr->abs.body, indent + 2);
+            print_indent(indent, '-', "ABS λ", (char*)symbol_name(expr->abs.param));
+            print_expr_debug(abs_body(expr), indent + 2);
             break;
 
         case EXPR_APP:
             printf("|%*sAPP:\n", indent, "");
-            print_expr_debug(expr->app.func, indent + 2);
-            print_expr_debug(expr->app.arg, indent + 2);
+            print_expr_debug(app_func(expr), indent + 2);
+            print_expr_debug(app_arg(expr), indent + 2);
             break;
 
         case EXPR_DEF:
             printf("|%*sDEF:\n", indent, "");
-            printf("|%*sname: %s\n", indent + 2, "", expr->def.name);
+            printf("|%*sname: %s\n", indent + 2, "", symbol_name(expr->def.name));
             print_expr_debug(expr->def.value, indent + 2);
             break;
     }
@@ -113,6 +276,7 @@ void expression_as_string(const Expr* e)
       case EXPR_VAR:    printf("EXPR_VAR "); break; // <name>
       case EXPR_ABS:    printf("EXPR_ABS "); break; // <function>
       case EXPR_APP:    printf("EXPR_APP "); break; // <application>
+      case EXPR_NUM:    printf("EXPR_NUM "); break; // <numeral>
       case EXPR_DEF:    printf("EXPR_DEF "); break;  // <assignment>
       case EXPR_IMPORT: printf("EXPR_IMPORT"); break; // <import>
     }
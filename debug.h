@@ -2,6 +2,7 @@
 #define DEBUG_H
 
 #include <assert.h>
+#include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -13,6 +14,7 @@ typedef enum {
     REDUCTION_DELTA,
     CONVERSION_ALPHA,
     REDUCTION_ETA,
+    REDUCTION_ARITH, // a numeral operation computed directly, see numeral.h
 } ReductionType;
 
 #define todo(msg) \
@@ -0,0 +1,380 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/mman.h>
+
+#include "parser.h"
+#include "stats.h"
+#include "stack.h"
+
+#define REGION_INITIAL_SLOTS 1024
+#define POOL_BLOCK_BITS 12
+#define POOL_BLOCK_NODES (1u << POOL_BLOCK_BITS)
+#define POOL_KEEP_BLOCKS 8 // kept by a reset, as much as the table keeps room for
+#define POOL_MAX_BLOCKS ((1u << 31) >> POOL_BLOCK_BITS) // reserved address space, 64 GB
+
+_Static_assert(sizeof(Expr) == 32, "Expr should stay 32 bytes");
+
+static Region default_region = {0};
+static Region* expr_region = &default_region;
+
+void set_expr_region(Region* region)
+{
+    expr_region = region;
+}
+
+Region* get_expr_region(void)
+{
+    return expr_region;
+}
+
+Expr* alloc_expr(ExprType type)
+{
+    Expr* e = arena_alloc(&expr_region->arena, sizeof(Expr));
+    e->type = type;
+    e->hash = 0;
+    e->size = 0;
+    e->free_bound = 0;
+    e->free_mask = 0;
+    return e;
+}
+
+char* alloc_name(const char* name, size_t len)
+{
+    return arena_strndup(&expr_region->arena, name, len);
+}
+
+static unsigned int mix(unsigned int h, unsigned int v)
+{
+    h ^= v + 0x9e3779b9u + (h << 6) + (h >> 2);
+    return h;
+}
+
+static void out_of_memory(void)
+{
+    fprintf(stderr, "Memory allocation failed\n");
+    exit(1);
+}
+
+/*
+ * Node pool. The nodes of every region live in one reservation of address
+ * space, so a node's id is its offset from node_pool and children are held
+ * as 32-bit ids. Regions take it a block at a time and hand whole blocks
+ * back, whose pages go back to the system. Pages are only backed once
+ * touched, the reservation itself costs nothing.
+ */
+Expr* node_pool = NULL;
+static uint32_t pool_blocks = 0;     // blocks the reservation holds
+static uint32_t pool_used = 0;       // blocks handed out at least once
+static struct { uint32_t* items; size_t count; size_t capacity; } pool_free = {0};
+
+static void pool_reserve(void)
+{
+    // settle for less where address space is limited
+    for (uint32_t blocks = POOL_MAX_BLOCKS; blocks >= 64; blocks /= 2) {
+        void* map = mmap(NULL, (size_t)blocks * POOL_BLOCK_NODES * sizeof(Expr), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (map != MAP_FAILED) {
+            node_pool = map;
+            pool_blocks = blocks;
+            return;
+        }
+    }
+    out_of_memory();
+}
+
+static uint32_t pool_take(void)
+{
+    if (pool_free.count > 0) return stack_pop(pool_free);
+    if (!node_pool) pool_reserve();
+    if (pool_used == pool_blocks) out_of_memory();
+    return pool_used++;
+}
+
+static void pool_give(uint32_t block)
+{
+    madvise(node_pool + ((size_t)block << POOL_BLOCK_BITS), POOL_BLOCK_NODES * sizeof(Expr), MADV_DONTNEED);
+    stack_push(pool_free, block);
+}
+
+static NodeId region_alloc(Region* region)
+{
+    size_t block = region->count >> POOL_BLOCK_BITS;
+    if (block == region->block_count) {
+        if (region->block_count == region->block_capacity) {
+            size_t capacity = region->block_capacity == 0 ? 16 : region->block_capacity * 2;
+            uint32_t* blocks = realloc(region->blocks, capacity * sizeof(uint32_t));
+            if (!blocks) out_of_memory();
+            region->blocks = blocks;
+            region->block_capacity = capacity;
+        }
+        region->blocks[region->block_count++] = pool_take();
+    }
+    NodeId id = region->blocks[block] << POOL_BLOCK_BITS | (region->count & (POOL_BLOCK_NODES - 1));
+    region->count++;
+    region->allocated++;
+    return id;
+}
+
+// children are unique, so comparing them by pointer is structural equality
+static bool same_node(const Expr* e, ExprType type, uintptr_t a, uintptr_t b)
+{
+    if (e->type != type) return false;
+    switch (type) {
+        case EXPR_VAR: return e->var.index == (int)a && e->var.name == (Symbol)b;
+        case EXPR_ABS: return e->abs.param == (Symbol)a && e->abs.body == (NodeId)b;
+        case EXPR_APP: return e->app.func == (NodeId)a && e->app.arg == (NodeId)b;
+        case EXPR_NUM: return e->num.value == (unsigned long)a && ((uint64_t)e->num.succ << 32 | e->num.zero) == b;
+        default: return false;
+    }
+}
+
+static Expr* region_find(Region* region, ExprType type, unsigned int hash, uintptr_t a, uintptr_t b)
+{
+    for (; region; region = region->parent) {
+        if (region->capacity == 0) continue;
+        size_t mask = region->capacity - 1;
+        for (size_t i = hash & mask; region->slot_node[i]; i = (i + 1) & mask) {
+            if (region->slot_hash[i] != hash) continue;
+            Expr* e = node_at(region->slot_node[i] - 1);
+            if (same_node(e, type, a, b)) return e;
+        }
+    }
+    return NULL;
+}
+
+static void region_insert(Region* region, unsigned int hash, NodeId id)
+{
+    // count already includes the node being inserted
+    if (region->count * 2 > region->capacity) {
+        size_t capacity = region->capacity == 0 ? REGION_INITIAL_SLOTS : region->capacity * 2;
+        unsigned int* slot_hash = malloc(capacity * sizeof(unsigned int));
+        NodeId* slot_node = calloc(capacity, sizeof(NodeId));
+        if (!slot_hash || !slot_node) out_of_memory();
+        for (size_t i = 0; i < region->capacity; i++) {
+            if (!region->slot_node[i]) continue;
+            size_t j = region->slot_hash[i] & (capacity - 1);
+            while (slot_node[j]) j = (j + 1) & (capacity - 1);
+            slot_hash[j] = region->slot_hash[i];
+            slot_node[j] = region->slot_node[i];
+        }
+        free(region->slot_hash);
+        free(region->slot_node);
+        region->slot_hash = slot_hash;
+        region->slot_node = slot_node;
+        region->capacity = capacity;
+    }
+
+    size_t mask = region->capacity - 1;
+    size_t i = hash & mask;
+    while (region->slot_node[i]) i = (i + 1) & mask;
+    region->slot_hash[i] = hash;
+    region->slot_node[i] = id + 1;
+}
+
+static bool in_table(const Region* region, const Expr* e)
+{
+    if (region->capacity == 0) return false;
+    size_t mask = region->capacity - 1;
+    for (size_t i = e->hash & mask; region->slot_node[i]; i = (i + 1) & mask) {
+        if (region->slot_hash[i] == e->hash && region->slot_node[i] - 1 == node_id(e)) return true;
+    }
+    return false;
+}
+
+bool region_owns(Region* region, Expr* e)
+{
+    if (e->type == EXPR_DEF || e->type == EXPR_IMPORT) return false;
+
+    for (; region; region = region->parent) {
+        if (in_table(region, e)) return true;
+    }
+    return false;
+}
+
+typedef struct {
+    Expr* node;
+    bool expanded;
+} EvacuateFrame;
+
+static struct { EvacuateFrame* items; size_t count; size_t capacity; } evacuate_work = {0};
+
+// A moved node has size 0, never true of a live hash-consed one, and keeps
+// its copy where the body of an abstraction goes
+static Expr* forwarded(Expr* e)
+{
+    return e->size == 0 && e->type <= EXPR_NUM ? abs_body(e) : e;
+}
+
+Expr* region_evacuate(Region* from, Expr* root)
+{
+    size_t base = evacuate_work.count;
+    stack_push(evacuate_work, ((EvacuateFrame){ root, false }));
+
+    while (evacuate_work.count > base) {
+        EvacuateFrame frame = stack_pop(evacuate_work);
+        Expr* node = frame.node;
+        if (forwarded(node) != node || !in_table(from, node)) continue; // moved already, or lives elsewhere
+
+        if (!frame.expanded && (node->type == EXPR_ABS || node->type == EXPR_APP)) {
+            stack_push(evacuate_work, ((EvacuateFrame){ node, true }));
+            if (node->type == EXPR_ABS) {
+                stack_push(evacuate_work, ((EvacuateFrame){ abs_body(node), false }));
+            } else {
+                stack_push(evacuate_work, ((EvacuateFrame){ app_arg(node), false }));
+                stack_push(evacuate_work, ((EvacuateFrame){ app_func(node), false }));
+            }
+            continue;
+        }
+
+        Expr* copy;
+        switch (node->type) {
+            case EXPR_VAR:
+                copy = node->var.index < 0 ? mk_free(node->var.name) : mk_var(node->var.index);
+                break;
+            case EXPR_ABS:
+                copy = mk_abs(node->abs.param, forwarded(abs_body(node)));
+                break;
+            case EXPR_APP:
+                copy = mk_app(forwarded(app_func(node)), forwarded(app_arg(node)));
+                break;
+            case EXPR_NUM:
+                copy = mk_num(node->num.value, node->num.succ, node->num.zero);
+                break;
+            default:
+                continue;
+        }
+        node->size = 0;
+        node->abs.body = node_id(copy);
+    }
+
+    return forwarded(root);
+}
+
+void reset_region(Region* region)
+{
+    arena_reset(&region->arena);
+    if (region->capacity > REGION_INITIAL_SLOTS * 64) {
+        // a huge evaluation should not pin its table forever
+        free(region->slot_hash);
+        free(region->slot_node);
+        region->slot_hash = NULL;
+        region->slot_node = NULL;
+        region->capacity = 0;
+    } else if (region->slot_node) {
+        memset(region->slot_node, 0, region->capacity * sizeof(NodeId));
+    }
+    while (region->block_count > POOL_KEEP_BLOCKS) pool_give(region->blocks[--region->block_count]);
+    region->count = 0;
+}
+
+void free_region(Region* region)
+{
+    arena_free(&region->arena);
+    for (size_t i = 0; i < region->block_count; i++) pool_give(region->blocks[i]);
+    free(region->blocks);
+    free(region->slot_hash);
+    free(region->slot_node);
+    *region = (Region){ .parent = region->parent };
+}
+
+// What a fresh region holding the same nodes would take. Blocks and table
+// room kept by a reset are not charged, so one large evaluation does not
+// eat into the memory budget of the ones after it.
+size_t region_size(const Region* region)
+{
+    size_t slots = REGION_INITIAL_SLOTS;
+    while (region->count * 2 > slots) slots *= 2;
+    return region->arena.size + region->count * sizeof(Expr) + slots * (sizeof(unsigned int) + sizeof(NodeId));
+}
+
+static unsigned int add_size(unsigned int a, unsigned int b)
+{
+    return a > UINT_MAX - b ? UINT_MAX : a + b;
+}
+
+static Expr* intern_node(ExprType type, unsigned int hash, uintptr_t a, uintptr_t b)
+{
+    Expr* e = region_find(expr_region, type, hash, a, b);
+    if (e) return e;
+
+    NodeId id = region_alloc(expr_region);
+    e = node_at(id);
+    e->type = type;
+    e->hash = hash;
+    stats.allocated++;
+    e->size = 1;
+    e->free_bound = 0;
+    e->free_mask = 0;
+    switch (type) {
+        case EXPR_VAR:
+            e->var.index = (int)a;
+            e->var.name = (Symbol)b;
+            if (e->var.index >= 0) {
+                e->free_bound = (unsigned)e->var.index < FREE_BOUND_MAX ? (unsigned)e->var.index + 1 : FREE_BOUND_MAX;
+                e->free_mask = e->var.index < FREE_MASK_BITS ? 1u << e->var.index : FREE_MASK_UNKNOWN;
+            }
+            break;
+        case EXPR_ABS:
+        {
+            Expr* body = node_at((NodeId)b);
+            e->abs.param = (Symbol)a;
+            e->abs.body = (NodeId)b;
+            e->size = add_size(1, body->size);
+            // a saturated bound has to stay saturated to remain a bound
+            e->free_bound = body->free_bound == FREE_BOUND_MAX ? FREE_BOUND_MAX : body->free_bound > 0 ? body->free_bound - 1u : 0u;
+            e->free_mask = body->free_mask == FREE_MASK_UNKNOWN ? FREE_MASK_UNKNOWN : body->free_mask >> 1;
+            break;
+        }
+        case EXPR_APP:
+        {
+            Expr* func = node_at((NodeId)a);
+            Expr* arg = node_at((NodeId)b);
+            e->app.func = (NodeId)a;
+            e->app.arg = (NodeId)b;
+            e->size = add_size(add_size(1, func->size), arg->size);
+            e->free_bound = func->free_bound > arg->free_bound ? func->free_bound : arg->free_bound;
+            e->free_mask = func->free_mask | arg->free_mask;
+            break;
+        }
+        case EXPR_NUM:
+            e->num.value = (unsigned long)a;
+            e->num.succ = (Symbol)((uint64_t)b >> 32);
+            e->num.zero = (Symbol)b;
+            break;
+        default: break;
+    }
+    region_insert(expr_region, hash, id);
+    return e;
+}
+
+Expr* mk_var(int index)
+{
+    unsigned int hash = mix(mix(EXPR_VAR, (unsigned int)index), SYMBOL_NONE);
+    return intern_node(EXPR_VAR, hash, (uintptr_t)index, SYMBOL_NONE);
+}
+
+Expr* mk_free(Symbol name)
+{
+    unsigned int hash = mix(mix(EXPR_VAR, (unsigned int)-1), name);
+    return intern_node(EXPR_VAR, hash, (uintptr_t)-1, name);
+}
+
+Expr* mk_abs(Symbol param, Expr* body)
+{
+    unsigned int hash = mix(mix(EXPR_ABS, param), body->hash);
+    return intern_node(EXPR_ABS, hash, param, node_id(body));
+}
+
+Expr* mk_app(Expr* func, Expr* arg)
+{
+    unsigned int hash = mix(mix(EXPR_APP, func->hash), arg->hash);
+    return intern_node(EXPR_APP, hash, node_id(func), node_id(arg));
+}
+
+Expr* mk_num(unsigned long value, Symbol succ, Symbol zero)
+{
+    unsigned int hash = mix(mix(mix(EXPR_NUM, (unsigned int)value), succ), zero);
+    return intern_node(EXPR_NUM, hash, (uintptr_t)value, (uint64_t)succ << 32 | zero);
+}
@@ -0,0 +1,356 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "image.h"
+#include "stack.h"
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t symbol_count;   // symbol 0 is SYMBOL_NONE and has no name
+    uint32_t node_count;
+    uint32_t def_count;
+    uint32_t names_size;
+    uint32_t reserved;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    uint64_t source_size;
+    uint64_t source_hash;
+} ImageHeader;
+
+// VAR: a = De Bruijn index (-1 for free), b = symbol
+// ABS: a = symbol, b = body node
+// APP: a = function node, b = argument node
+typedef struct {
+    uint32_t type;
+    uint32_t a;
+    uint32_t b;
+} ImageNode;
+
+typedef struct {
+    uint32_t name;   // symbol
+    uint32_t value;  // node
+} ImageDef;
+
+static char* image_path(const char* source)
+{
+    size_t len = strlen(source);
+    char* path = malloc(len + 2);
+    if (!path) return NULL;
+    memcpy(path, source, len);
+    path[len] = 'c';
+    path[len + 1] = '\0';
+    return path;
+}
+
+// FNV-1a over the source file
+static bool hash_file(const char* path, uint64_t* hash)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+
+    uint64_t h = 14695981039346656037ull;
+    unsigned char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        for (size_t i = 0; i < n; i++) h = (h ^ buffer[i]) * 1099511628211ull;
+    }
+    fclose(f);
+    *hash = h;
+    return true;
+}
+
+static bool image_current(const ImageHeader* header, const char* source, const struct stat* st)
+{
+    if (header->source_size != (uint64_t)st->st_size) return false;
+    if (header->source_mtime_sec == st->st_mtim.tv_sec && header->source_mtime_nsec == st->st_mtim.tv_nsec) return true;
+
+    uint64_t hash;
+    return hash_file(source, &hash) && hash == header->source_hash; // touched but unchanged
+}
+
+static bool build_nodes(const ImageHeader* header, const char* base, ImageDefine define, void* ctx)
+{
+    const uint32_t* offsets = (const uint32_t*)(base + sizeof(ImageHeader));
+    const ImageNode* nodes = (const ImageNode*)(offsets + header->symbol_count);
+    const ImageDef* defs = (const ImageDef*)(nodes + header->node_count);
+    const char* names = (const char*)(defs + header->def_count);
+
+    Symbol* symbols = malloc((header->symbol_count + 1) * sizeof(Symbol));
+    Expr** built = malloc((header->node_count + 1) * sizeof(Expr*));
+    bool ok = symbols && built && header->symbol_count > 0;
+
+    for (uint32_t i = 1; ok && i < header->symbol_count; i++) {
+        ok = offsets[i] < header->names_size && memchr(names + offsets[i], '\0', header->names_size - offsets[i]);
+        if (ok) symbols[i] = intern_cstr(names + offsets[i]);
+    }
+    if (ok) symbols[0] = SYMBOL_NONE;
+
+    // children come before their parents, so every index is checked against i
+    for (uint32_t i = 0; ok && i < header->node_count; i++) {
+        const ImageNode* n = &nodes[i];
+        switch (n->type) {
+            case EXPR_VAR:
+                ok = n->b < header->symbol_count;
+                if (!ok) break;
+                built[i] = (int32_t)n->a < 0 ? mk_free(symbols[n->b]) : mk_var((int32_t)n->a);
+                break;
+            case EXPR_ABS:
+                ok = n->a < header->symbol_count && n->b < i;
+                if (ok) built[i] = mk_abs(symbols[n->a], built[n->b]);
+                break;
+            case EXPR_APP:
+                ok = n->a < i && n->b < i;
+                if (ok) built[i] = mk_app(built[n->a], built[n->b]);
+                break;
+            default:
+                ok = false;
+        }
+    }
+
+    for (uint32_t i = 0; ok && i < header->def_count; i++) {
+        ok = defs[i].name < header->symbol_count && defs[i].value < header->node_count;
+    }
+    for (uint32_t i = 0; ok && i < header->def_count; i++) {
+        define(symbols[defs[i].name], built[defs[i].value], ctx);
+    }
+
+    free(symbols);
+    free(built);
+    return ok;
+}
+
+bool image_load(const char* source, ImageDefine define, void* ctx)
+{
+    char* path = image_path(source);
+    if (!path) return false;
+    int fd = open(path, O_RDONLY);
+    free(path);
+    if (fd < 0) return false;
+
+    struct stat st, source_st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ImageHeader) || stat(source, &source_st) != 0) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const ImageHeader* header = map;
+    uint64_t expected = sizeof(ImageHeader) + (uint64_t)header->symbol_count * sizeof(uint32_t) +
+                        (uint64_t)header->node_count * sizeof(ImageNode) +
+                        (uint64_t)header->def_count * sizeof(ImageDef) + header->names_size;
+    bool ok = memcmp(header->magic, IMAGE_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == IMAGE_VERSION &&
+              expected == (uint64_t)st.st_size &&
+              image_current(header, source, &source_st) &&
+              build_nodes(header, map, define, ctx);
+
+    munmap(map, st.st_size);
+    return ok;
+}
+
+typedef struct {
+    const Expr* node;
+    bool expanded;
+} SaveFrame;
+
+static struct { SaveFrame* items; size_t count; size_t capacity; } save_work = {0};
+
+// Node and symbol numbering while an image is written
+typedef struct {
+    struct { ImageNode* items; size_t count; size_t capacity; } nodes;
+    struct { uint32_t* items; size_t count; size_t capacity; } offsets;
+    struct { char* items; size_t count; size_t capacity; } names;
+    const Expr** seen;       // open addressing, node -> index in seen_index
+    uint32_t* seen_index;
+    size_t seen_capacity;
+    uint32_t* symbol_index;  // Symbol id -> image symbol, 0 if not added yet
+    size_t symbol_capacity;
+} ImageWriter;
+
+static uint32_t add_symbol(ImageWriter* w, Symbol sym)
+{
+    if (sym == SYMBOL_NONE) return 0;
+    if (sym >= w->symbol_capacity) {
+        size_t capacity = w->symbol_capacity ? w->symbol_capacity : 256;
+        while (capacity <= sym) capacity *= 2;
+        w->symbol_index = realloc(w->symbol_index, capacity * sizeof(uint32_t));
+        if (!w->symbol_index) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        memset(w->symbol_index + w->symbol_capacity, 0, (capacity - w->symbol_capacity) * sizeof(uint32_t));
+        w->symbol_capacity = capacity;
+    }
+    if (w->symbol_index[sym]) return w->symbol_index[sym];
+
+    const char* name = symbol_name(sym);
+    stack_push(w->offsets, (uint32_t)w->names.count);
+    for (const char* c = name; ; c++) {
+        stack_push(w->names, *c);
+        if (!*c) break;
+    }
+    w->symbol_index[sym] = (uint32_t)(w->offsets.count - 1);
+    return w->symbol_index[sym];
+}
+
+static size_t seen_slot(ImageWriter* w, const Expr* node)
+{
+    size_t mask = w->seen_capacity - 1;
+    size_t i = (node->hash * 2654435769u) & mask;
+    while (w->seen[i] && w->seen[i] != node) i = (i + 1) & mask;
+    return i;
+}
+
+static void mark_seen(ImageWriter* w, const Expr* node, uint32_t index)
+{
+    if ((w->nodes.count + 1) * 2 > w->seen_capacity) {
+        const Expr** old = w->seen;
+        uint32_t* old_index = w->seen_index;
+        size_t old_capacity = w->seen_capacity;
+        w->seen_capacity = old_capacity ? old_capacity * 2 : 1024;
+        w->seen = calloc(w->seen_capacity, sizeof(Expr*));
+        w->seen_index = malloc(w->seen_capacity * sizeof(uint32_t));
+        if (!w->seen || !w->seen_index) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (!old[i]) continue;
+            size_t slot = seen_slot(w, old[i]);
+            w->seen[slot] = old[i];
+            w->seen_index[slot] = old_index[i];
+        }
+        free(old);
+        free(old_index);
+    }
+    size_t slot = seen_slot(w, node);
+    w->seen[slot] = node;
+    w->seen_index[slot] = index;
+}
+
+static bool find_seen(ImageWriter* w, const Expr* node, uint32_t* index)
+{
+    if (w->seen_capacity == 0) return false;
+    size_t slot = seen_slot(w, node);
+    if (!w->seen[slot]) return false;
+    *index = w->seen_index[slot];
+    return true;
+}
+
+// Number the nodes of expr in post-order, shared subterms once
+static bool add_term(ImageWriter* w, const Expr* expr, uint32_t* index)
+{
+    size_t base = save_work.count;
+    stack_push(save_work, ((SaveFrame){ expr, false }));
+
+    while (save_work.count > base) {
+        SaveFrame frame = stack_pop(save_work);
+        const Expr* node = frame.node;
+        uint32_t known;
+        if (find_seen(w, node, &known)) continue;
+
+        if (!frame.expanded && (node->type == EXPR_ABS || node->type == EXPR_APP)) {
+            stack_push(save_work, ((SaveFrame){ node, true }));
+            if (node->type == EXPR_ABS) {
+                stack_push(save_work, ((SaveFrame){ abs_body(node), false }));
+            } else {
+                stack_push(save_work, ((SaveFrame){ app_arg(node), false }));
+                stack_push(save_work, ((SaveFrame){ app_func(node), false }));
+            }
+            continue;
+        }
+
+        ImageNode out = { node->type, 0, 0 };
+        uint32_t child = 0;
+        switch (node->type) {
+            case EXPR_VAR:
+                out.a = (uint32_t)node->var.index;
+                out.b = node->var.index < 0 ? add_symbol(w, node->var.name) : 0;
+                break;
+            case EXPR_ABS:
+                out.a = add_symbol(w, node->abs.param);
+                find_seen(w, abs_body(node), &child);
+                out.b = child;
+                break;
+            case EXPR_APP:
+                find_seen(w, app_func(node), &child);
+                out.a = child;
+                find_seen(w, app_arg(node), &child);
+                out.b = child;
+                break;
+            default:
+                save_work.count = base; // numerals never come out of the parser
+                return false;
+        }
+        mark_seen(w, node, (uint32_t)w->nodes.count);
+        stack_push(w->nodes, out);
+    }
+
+    return find_seen(w, expr, index);
+}
+
+void image_save(const char* source, Expr** defs, size_t count)
+{
+    struct stat st;
+    uint64_t hash;
+    if (stat(source, &st) != 0 || !hash_file(source, &hash)) return;
+
+    ImageWriter w = {0};
+    stack_push(w.offsets, 0);  // SYMBOL_NONE
+    stack_push(w.names, '\0');
+    ImageDef* out_defs = malloc((count ? count : 1) * sizeof(ImageDef));
+    bool ok = out_defs != NULL;
+    for (size_t i = 0; ok && i < count; i++) {
+        out_defs[i].name = add_symbol(&w, defs[i]->def.name);
+        ok = add_term(&w, defs[i]->def.value, &out_defs[i].value);
+    }
+
+    char* path = image_path(source);
+    char* temp = path ? malloc(strlen(path) + 32) : NULL;
+    if (ok && temp) {
+        ImageHeader header = {
+            .version = IMAGE_VERSION,
+            .symbol_count = (uint32_t)w.offsets.count,
+            .node_count = (uint32_t)w.nodes.count,
+            .def_count = (uint32_t)count,
+            .names_size = (uint32_t)w.names.count,
+            .source_mtime_sec = st.st_mtim.tv_sec,
+            .source_mtime_nsec = st.st_mtim.tv_nsec,
+            .source_size = (uint64_t)st.st_size,
+            .source_hash = hash,
+        };
+        memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+
+        // write aside and rename, so a reader never maps half an image
+        snprintf(temp, strlen(path) + 32, "%s.%ld", path, (long)getpid());
+        FILE* f = fopen(temp, "wb");
+        if (f) {
+            bool written = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                           fwrite(w.offsets.items, sizeof(uint32_t), w.offsets.count, f) == w.offsets.count &&
+                           fwrite(w.nodes.items, sizeof(ImageNode), w.nodes.count, f) == w.nodes.count &&
+                           fwrite(out_defs, sizeof(ImageDef), count, f) == count &&
+                           fwrite(w.names.items, 1, w.names.count, f) == w.names.count;
+            written = fclose(f) == 0 && written;
+            if (!written || rename(temp, path) != 0) remove(temp);
+        }
+    }
+
+    free(temp);
+    free(path);
+    free(out_defs);
+    free(w.nodes.items);
+    free(w.offsets.items);
+    free(w.names.items);
+    free(w.seen);
+    free(w.seen_index);
+    free(w.symbol_index);
+}
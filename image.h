@@ -0,0 +1,34 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parser.h"
+
+/*
+ * Precompiled module images.
+ *
+ * The first import of a module writes its definitions next to the source
+ * as `<module>.lc`: a header, the symbols the module uses and its term
+ * nodes in post-order, children referred to by index. Later imports mmap
+ * the image and build the hash-consed nodes straight from it, without
+ * reading, tokenising or parsing the source.
+ *
+ * An image records the size, mtime and a content hash of its source. It is
+ * used while the size matches and either the mtime or the hash does, and is
+ * rewritten otherwise. Any image that fails to validate is ignored.
+ */
+
+#define IMAGE_MAGIC "LAMBIMG1"
+#define IMAGE_VERSION 1
+
+typedef void (*ImageDefine)(Symbol name, Expr* value, void* ctx);
+
+// Define everything from the image of `source`, false if there is no usable one
+bool image_load(const char* source, ImageDefine define, void* ctx);
+
+// Write the image of `source` from its definitions, failures are ignored
+void image_save(const char* source, Expr** defs, size_t count);
+
+#endif // IMAGE_H
@@ -1,142 +1,242 @@
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
-#include <libgen.h>    
 #include <unistd.h>   
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <stdatomic.h>
 
 #include "interpreter.h"
+#include "machine.h"
+#include "vm.h"
+#include "net.h"
+#include "budget.h"
+#include "stats.h"
+#include "trace.h"
+#include "memo.h"
+#include "image.h"
+#include "module.h"
+#include "spawn.h"
 #include "diagnostics.h"
 #include "debug.h"
+#include "stack.h"
 
 static Env* global_env = NULL;
 static char* current_file_path = NULL;
+static EvalMode eval_mode = EVAL_SUBST;
+static int eval_threads = 0;  // workers for the parallel backends, 0 picks one per core
+static int eval_jobs = 1;     // processes evaluating independent top-level expressions
+static bool show_stats = false;
 
+// The global env and its definitions live for the whole process, everything
+// produced while evaluating one top-level expression is dropped after printing
+static Region env_region = {0};
+static Region eval_region = { .parent = &env_region };
 
-void env_add(Env** env, const char* name, Expr* value)
+
+#define ENV_INITIAL_CAPACITY 128
+
+static size_t env_slot(Symbol name, size_t capacity)
+{
+    return (name * 2654435769u) & (capacity - 1); // ids are dense, spread them out
+}
+
+static void env_grow(Env* env)
 {
-    Env* entry = malloc(sizeof(Expr));
-    if (!entry)
+    size_t capacity = env->capacity == 0 ? ENV_INITIAL_CAPACITY : env->capacity * 2;
+    EnvEntry* entries = calloc(capacity, sizeof(EnvEntry));
+    if (!entries)
     {
         report_interp(DIAG_ERROR, "Env Memory allocation failed");
         return;
     }
-    entry->name = strdup(name);
-    if (!entry->name)
+
+    for (size_t i = 0; i < env->capacity; i++)
     {
-        free(entry);
-        report_interp(DIAG_ERROR, "Memory allocation failed");
-        return;
+        EnvEntry entry = env->entries[i];
+        if (entry.name == SYMBOL_NONE) continue;
+        size_t j = env_slot(entry.name, capacity);
+        while (entries[j].name != SYMBOL_NONE) j = (j + 1) & (capacity - 1);
+        entries[j] = entry;
     }
-    entry->value = copy_expr(value);
-    if (!entry->value)
+
+    free(env->entries);
+    env->entries = entries;
+    env->capacity = capacity;
+}
+
+// Definitions are copied into the long-lived env region
+void env_add(Env** env, Symbol name, Expr* value)
+{
+    if (!*env)
     {
-        free((void*)entry->name);
-        free(entry);
-        report_interp(DIAG_ERROR, "Memory allocation failed");
-        return;
+        *env = calloc(1, sizeof(Env));
+        if (!*env)
+        {
+            report_interp(DIAG_ERROR, "Env Memory allocation failed");
+            return;
+        }
     }
-    entry->next = *env;
-    *env = entry;
+
+    Env* table = *env;
+    if ((table->count + 1) * 2 > table->capacity) env_grow(table);
+
+    Region* prev = get_expr_region();
+    set_expr_region(&env_region);
+    Expr* copy = copy_expr(value);
+    set_expr_region(prev);
+
+    size_t mask = table->capacity - 1;
+    size_t i = env_slot(name, table->capacity);
+    while (table->entries[i].name != SYMBOL_NONE && table->entries[i].name != name) i = (i + 1) & mask;
+
+    if (table->entries[i].name == SYMBOL_NONE) table->count++;
+    table->entries[i].name = name;
+    table->entries[i].value = copy;
+    table->entries[i].op_generation = 0;
+    table->generation++; // a redefinition can change what other globals compute
 }
 
-Expr* env_lookup(Env* env, const char* name)
+static EnvEntry* env_entry(Env* env, Symbol name)
 {
-    for (; env != NULL; env = env->next) {
-        if (strcmp(env->name, name) == 0) {
-            return env->value;
-        }
+    if (!env || env->capacity == 0) return NULL;
+
+    size_t mask = env->capacity - 1;
+    for (size_t i = env_slot(name, env->capacity); env->entries[i].name != SYMBOL_NONE; i = (i + 1) & mask)
+    {
+        if (env->entries[i].name == name) return &env->entries[i];
     }
     return NULL;
 }
 
-void free_env(Env* env)
+Expr* env_lookup(Env* env, Symbol name)
 {
-    while (env) {
-        Env* next = env->next;
-        free_expr(env->value);
-        free((void*)env->name);
-        free(env);              
-        env = next;
-    }
+    EnvEntry* entry = env_entry(env, name);
+    return entry ? entry->value : NULL;
 }
 
-Expr* copy_expr(Expr* expr)
+// Values are all carved from env_region, so they go at once with the table
+void free_env(Env* env)
 {
-    if (!expr) return NULL;
+    if (!env) return;
+    free(env->entries);
+    free(env);
+    reset_region(&env_region);
+    if (env == global_env) global_env = NULL;
+}
 
-    Expr* new_expr = malloc(sizeof(Expr));
-    new_expr->type = expr->type;
+/*
+ * Term traversals run on explicit heap stacks rather than the C stack, so
+ * the depth of a term is bounded by memory only. The stacks are shared and
+ * each traversal works above the base it found, so they may nest.
+ */
 
-    switch (expr->type) {
-        case EXPR_VAR:
-            new_expr->var.name = strdup(expr->var.name);
-            break;
-        case EXPR_ABS:
-            new_expr->abs.param = strdup(expr->abs.param);
-            new_expr->abs.body = copy_expr(expr->abs.body);
-            break;
-        case EXPR_APP:
-            new_expr->app.func = copy_expr(expr->app.func);
-            new_expr->app.arg = copy_expr(expr->app.arg);
-            break;
-        case EXPR_DEF:
-            new_expr->def.name = strdup(expr->def.name);
-            new_expr->def.value = copy_expr(expr->def.value);
-            break;
-        case EXPR_IMPORT:
-            new_expr->impt.filename = strdup(expr->impt.filename);
-            break;
-    }
+// Called on the way down. Returns the rebuilt node, or NULL to rebuild an
+// abstraction or application from its rebuilt children.
+typedef Expr* (*RebuildFn)(Expr* node, int depth, void* ctx);
 
-    return new_expr;
-}
+typedef struct {
+    Expr* node;
+    int depth;
+    bool children_done;
+} RebuildFrame;
+
+static struct { RebuildFrame* items; size_t count; size_t capacity; } rebuild_work = {0};
+static struct { Expr** items; size_t count; size_t capacity; } rebuild_results = {0};
 
-char* resolve_relative_path(const char* current_file_path, const char* import_filename)
+static Expr* rebuild(Expr* expr, int depth, RebuildFn visit, void* ctx)
 {
-    char* path_copy = strdup(current_file_path);
-    char* dir = dirname(path_copy);
+    size_t base = rebuild_work.count;
+    stack_push(rebuild_work, ((RebuildFrame){ expr, depth, false }));
+
+    while (rebuild_work.count > base)
+    {
+        RebuildFrame frame = stack_pop(rebuild_work);
+        Expr* node = frame.node;
 
-    size_t full_len = strlen(dir) + strlen(import_filename) + 2;
-    char* full_path = malloc(full_len);
-    snprintf(full_path, full_len, "%s/%s", dir, import_filename);
+        if (frame.children_done)
+        {
+            if (node->type == EXPR_ABS)
+            {
+                Expr* body = stack_pop(rebuild_results);
+                stack_push(rebuild_results, mk_abs(node->abs.param, body));
+            }
+            else
+            {
+                Expr* arg = stack_pop(rebuild_results);
+                Expr* func = stack_pop(rebuild_results);
+                stack_push(rebuild_results, mk_app(func, arg));
+            }
+            continue;
+        }
 
-    char* resolved = realpath(full_path, NULL);
+        Expr* done = visit(node, frame.depth, ctx);
+        if (done)
+        {
+            stack_push(rebuild_results, done);
+            continue;
+        }
 
-    free(full_path);
-    free(path_copy);
-    return resolved;  // Remember to free this later!
-}
+        frame.children_done = true;
+        stack_push(rebuild_work, frame);
+        if (node->type == EXPR_ABS)
+        {
+            stack_push(rebuild_work, ((RebuildFrame){ abs_body(node), frame.depth + 1, false }));
+        }
+        else
+        {
+            stack_push(rebuild_work, ((RebuildFrame){ app_arg(node), frame.depth, false }));
+            stack_push(rebuild_work, ((RebuildFrame){ app_func(node), frame.depth, false }));
+        }
+    }
 
-static bool file_is_readable(const char* path)
-{
-    return path && access(path, R_OK) == 0;
+    return stack_pop(rebuild_results);
 }
 
-static char* join_path(const char* a, const char* b)
+static Expr* copy_visit(Expr* node, int depth, void* ctx)
 {
-    size_t len = strlen(a) + strlen(b) + 2;
-    char* out = malloc(len);
-    snprintf(out, len, "%s/%s", a, b);
-    return out;
-}
+    if (region_owns(get_expr_region(), node)) return node;
+    stats.copied++;
 
-static bool ends_with(const char* s, const char* suffix)
-{
-    size_t ls = strlen(s), lsf = strlen(suffix);
-    return ls >= lsf && strcmp(s + (ls - lsf), suffix) == 0;
+    switch (node->type) {
+        case EXPR_VAR:
+            return node->var.index < 0 ? mk_free(node->var.name) : mk_var(node->var.index);
+        case EXPR_ABS:
+        case EXPR_APP:
+            return NULL;
+        case EXPR_NUM:
+            return mk_num(node->num.value, node->num.succ, node->num.zero);
+        default:
+            return node;
+    }
 }
 
-static char* with_ext(const char* filename, const char* new_ext)
+// Rebuild expr in the current region. Subterms the region (or a longer
+// lived parent) already holds are shared, so this only copies what is new.
+Expr* copy_expr(Expr* expr)
 {
-    const char* dot = strrchr(filename, '.');
-    size_t base_len = dot ? (size_t)(dot - filename) : strlen(filename);
-    size_t out_len = base_len + strlen(new_ext) + 1;
-    char* out = malloc(out_len);
-    memcpy(out, filename, base_len);
-    strcpy(out + base_len, new_ext);
-    return out;
+    if (!expr) return NULL;
+
+    switch (expr->type) {
+        case EXPR_DEF:
+        {
+            Expr* new_expr = alloc_expr(EXPR_DEF);
+            new_expr->def.name = expr->def.name;
+            new_expr->def.value = copy_expr(expr->def.value);
+            return new_expr;
+        }
+        case EXPR_IMPORT:
+        {
+            Expr* new_expr = alloc_expr(EXPR_IMPORT);
+            new_expr->impt.filename = alloc_name(expr->impt.filename, strlen(expr->impt.filename));
+            return new_expr;
+        }
+        default:
+            return rebuild(expr, 0, copy_visit, NULL);
+    }
 }
 
 void set_current_file_path(const char* path)
@@ -147,107 +247,107 @@ void set_current_file_path(const char* path)
     current_file_path = rp ? rp : strdup(path);
 }
 
-static char* resolve_import_path(const char* import_filename)
+// A mapped source file, its tokens point into the mapping
+typedef struct {
+    void* map;
+    size_t length;
+    TokenStream tokens;
+    ExprStream exprs;   // one view into `tokens` per expression
+} Source;
+
+// Lexes the file at `path` in one pass over its mapping, release with free_source
+static bool read_source(const char* path, Source* source, int* invalid)
 {
-    if (!import_filename || !*import_filename) return NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
 
-    // If current file is known, try relative to it first
-    if (current_file_path) {
-        char* rel = resolve_relative_path(current_file_path, import_filename);
-        if (file_is_readable(rel)) return rel; 
-        if (rel) free(rel);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
     }
 
-    // Try as given (absolute or CWD-relative)
-    if (file_is_readable(import_filename)) return strdup(import_filename);
+    *source = (Source){ .length = st.st_size };
+    if (source->length > 0) {
+        source->map = mmap(NULL, source->length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (source->map == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        madvise(source->map, source->length, MADV_SEQUENTIAL);
+    }
+    close(fd);
 
-    // Try examples/ prefix
-    char* ex1 = join_path("examples", import_filename);
-    if (file_is_readable(ex1)) return ex1;
-    free(ex1);
+    TokenStream* tokens = &source->tokens;
+    *tokens = tokenise_source(source->map ? source->map : "", source->length, invalid);
 
-    // Handle .lamb -> .l fallback
-    if (ends_with(import_filename, ".lamb")) {
-        char* alt = with_ext(import_filename, ".l");
-        // relative to current file
-        if (current_file_path) {
-            char* rel_alt = resolve_relative_path(current_file_path, alt);
-            if (file_is_readable(rel_alt)) { free(alt); return rel_alt; }
-            if (rel_alt) free(rel_alt);
-        }
-        // as given
-        if (file_is_readable(alt)) { char* r = alt; return r; }
-        // examples/
-        char* ex2 = join_path("examples", alt);
-        free(alt);
-        if (file_is_readable(ex2)) return ex2;
-        free(ex2);
+    size_t count = 0;
+    for (int i = 0; i < tokens->count; i++) count += tokens->tokens[i].type == TOKEN_EOF;
+
+    ExprStream* exprs = &source->exprs;
+    TokenStream* views = malloc((count + 1) * sizeof(TokenStream));
+    *exprs = (ExprStream){ .expressions = malloc((count + 1) * sizeof(TokenStream*)), .capacity = count + 1 };
+    if (!views || !exprs->expressions) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
     }
+    int start = 0;
+    for (int i = 0; i < tokens->count; i++) {
+        if (tokens->tokens[i].type != TOKEN_EOF) continue;
+        views[exprs->count] = (TokenStream){ tokens->tokens + start, i - start + 1 };
+        exprs->expressions[exprs->count] = &views[exprs->count];
+        exprs->count++;
+        start = i + 1;
+    }
+    if (count == 0) free(views);
+    return true;
+}
 
-    return NULL;
+static void free_source(Source* source)
+{
+    if (source->exprs.count > 0) free(source->exprs.expressions[0]); // the views
+    free(source->exprs.expressions);
+    free_token_stream(&source->tokens);
+    if (source->map) munmap(source->map, source->length);
+}
+
+static void define_global(Symbol name, Expr* value, void* ctx)
+{
+    env_add(&global_env, name, value);
 }
 
 Expr* eval_module(Expr* expr, Env** env)
 {
     const char* raw = expr->impt.filename;
-    char* filename = resolve_import_path(raw);
+    const char* filename = resolve_module(current_file_path, raw);
     if (!filename) {
         char err_msg[256];
         snprintf(err_msg, sizeof(err_msg), "Import Failed: Could not resolve module '%s'", raw);
         report_interp(DIAG_ERROR, err_msg);
         return NULL;
     }
+    if (!module_first_load(filename)) return NULL; // its definitions are already in the env
+
+    if (image_load(filename, define_global, NULL)) return NULL;
 
-    FILE *fptr = fopen(filename, "r");
-    if (!fptr) {
+    Source source;
+    int invalid;
+    if (!read_source(filename, &source, &invalid)) {
         char err_msg[256];
         snprintf(err_msg, sizeof(err_msg), "Import Failed: Could not read module '%s' (%s)", filename, strerror(errno));
         report_interp(DIAG_ERROR, err_msg);
-        free(filename);
         return NULL;
     }
+    for (int i = 0; i < invalid; i++) report_interp(DIAG_ERROR, "Failed to tokenize input module\n");
 
     // Set current file path to this module (for nested imports), and restore later
     char* prev_path = current_file_path ? strdup(current_file_path) : NULL;
     set_current_file_path(filename);
 
-    ExprStream module_exprs = {0};
-  
-    char contents[100];
-    while (fgets(contents, sizeof(contents), fptr))
-    {
-        // strip new lines
-        size_t len = strlen(contents);
-        if (len > 0 && contents[len - 1] == '\n')
-            contents[--len] = '\0';
-
-        // Skip blank lines and comment lines starting with "--"
-        size_t i = 0;
-        while (i < len && isspace((unsigned char)contents[i])) i++;
-
-        if (i == len || (contents[i] == '-' && contents[i + 1] == '-')) {
-            continue; // Skip blank or comment line
-        }
-
-        TokenStream tokens = tokenise(contents);
-        if (tokens.tokens == NULL)
-        {
-            report_interp(DIAG_ERROR, "Failed to tokenize input module\n");
-        }
-
-        // Allocate token stream on heap
-        TokenStream* heap_tokens = malloc(sizeof(TokenStream));
-        if (!heap_tokens) {
-            fprintf(stderr, "Memory allocation failed\n");
-            continue;
-        }
-        *heap_tokens = tokens;
-
-        da_append(module_exprs, heap_tokens);
-    }
-
-    fclose(fptr);
-  
+    ExprStream module_exprs = source.exprs;
+    Expr** defs = malloc((module_exprs.count + 1) * sizeof(Expr*));
+    size_t def_count = 0;
+    bool has_imports = false;
     for (int i = 0; i < module_exprs.count; i++)
     {
         int pos = 0;
@@ -256,22 +356,24 @@ Expr* eval_module(Expr* expr, Env** env)
 
         if (parsed->type == EXPR_DEF)
         {
-            env_add(&global_env, parsed->def.name, copy_expr(parsed->def.value));
+            env_add(&global_env, parsed->def.name, parsed->def.value);
+            if (defs) defs[def_count++] = parsed;
+        }
+        else if (parsed->type == EXPR_IMPORT)
+        {
+            eval_module(parsed, env);
+            has_imports = true;
         }
         else 
         {
-            report_interp(DIAG_ERROR, "Only definitions are allowed in module files");
+            report_interp(DIAG_ERROR, "Only definitions and imports are allowed in module files");
         }
-
-        free_expr(parsed);
     }
+    // the next import skips parsing, images only hold definitions
+    if (defs && !has_imports) image_save(filename, defs, def_count);
+    free(defs);
 
-    // Clean up token streams
-    for (int i = 0; i < module_exprs.count; i++) {
-        free_token_stream(module_exprs.expressions[i]);
-        free(module_exprs.expressions[i]);
-    }
-    free(module_exprs.expressions);
+    free_source(&source);
 
     // Restore previous current file path
     if (prev_path) {
@@ -279,257 +381,746 @@ Expr* eval_module(Expr* expr, Env** env)
         free(prev_path);
     }
 
-    free(filename);
     return NULL;
 }
 
-bool is_free_in(const char* name, Expr* expr)
+typedef struct {
+    Expr* node;
+    int index;
+} FreeFrame;
+
+static struct { FreeFrame* items; size_t count; size_t capacity; } free_work = {0};
+
+// Does the De Bruijn index `index` occur free in expr. The cached summary
+// answers directly unless the term has indices past 31.
+bool is_free_in(int index, Expr* expr)
 {
-    switch (expr->type)
+    if (index < 0 || (unsigned)index >= expr->free_bound) return false;
+    if (expr->free_mask != FREE_MASK_UNKNOWN) return index < FREE_MASK_BITS && (expr->free_mask >> index & 1);
+
+    size_t base = free_work.count;
+    stack_push(free_work, ((FreeFrame){ expr, index }));
+
+    while (free_work.count > base)
     {
-        case EXPR_ABS: 
+        FreeFrame frame = stack_pop(free_work);
+        if ((unsigned)frame.index >= frame.node->free_bound) continue;
+        if (frame.node->free_mask != FREE_MASK_UNKNOWN)
         {
-            if (strcmp(expr->abs.param, name) == 0)
-            {
-                return false; // it is bound 
-            }
-            else
+            if (frame.index < FREE_MASK_BITS && (frame.node->free_mask >> frame.index & 1))
             {
-                return is_free_in(name, expr->abs.body);
+                free_work.count = base;
+                return true;
             }
+            continue;
         }
-        case EXPR_APP:
-        {
-            return is_free_in(name, expr->app.func) || is_free_in(name, expr->app.arg);
-        }
-        case EXPR_VAR:
+        switch (frame.node->type)
         {
-            return strcmp(expr->var.name, name) == 0;    
+            case EXPR_ABS: 
+                stack_push(free_work, ((FreeFrame){ abs_body(frame.node), frame.index + 1 }));
+                break;
+            case EXPR_APP:
+                stack_push(free_work, ((FreeFrame){ app_arg(frame.node), frame.index }));
+                stack_push(free_work, ((FreeFrame){ app_func(frame.node), frame.index }));
+                break;
+            case EXPR_VAR:
+                if (frame.node->var.index == frame.index)
+                {
+                    free_work.count = base;
+                    return true;
+                }
+                break;
+            case EXPR_NUM:
+            case EXPR_IMPORT:
+            case EXPR_DEF:
+                break;
         }
-        case EXPR_IMPORT:
-        case EXPR_DEF:
-            return false;
     }
     return false;
 }
 
-Expr* eval(Expr* expr, Env* env)
+typedef enum {
+    EVAL_FRAME_ABS,  // wrap the value in an abstraction
+    EVAL_FRAME_ARG,  // the function is done, evaluate the argument next
+    EVAL_FRAME_CALL, // the argument is done, apply the function to it
+    EVAL_FRAME_MEMO, // the value is the normal form of (expr arg), remember it
+} EvalFrameKind;
+
+typedef struct {
+    EvalFrameKind kind;
+    Expr* expr;
+    Expr* arg;       // EVAL_FRAME_MEMO only
+    bool arith;      // EVAL_FRAME_MEMO: arith_left from before the call
+    bool spawned;    // EVAL_FRAME_ARG: a worker is normalising expr, see spawn.h
+} EvalFrame;
+
+static struct { EvalFrame* items; size_t count; size_t capacity; } eval_work = {0};
+static struct { Spawned* items; size_t count; size_t capacity; } spawn_jobs = {0}; // one per spawned frame
+
+// Globals that normalise to an arithmetic combinator stay named while eval
+// runs, their applications wait for numerals instead of being unfolded
+static bool use_arith = true;
+static bool arith_left = false; // a combinator may still be in the value
+
+// Beta steps left before eval gives up and returns NULL, negative for no limit.
+// Bounds the look at definitions such as Y that have no normal form.
+static long eval_fuel = -1;
+#define ARITH_FUEL 10000
+
+static ArithOp global_op(Env* env, Symbol name)
 {
-    switch (expr->type)
+    EnvEntry* entry = env_entry(env, name);
+    if (!use_arith || !entry) return ARITH_NONE;
+
+    if (entry->op_generation != env->generation)
     {
-        case EXPR_VAR: 
+        use_arith = false;
+        eval_fuel = ARITH_FUEL;
+        Expr* normal = eval(entry->value, env);
+        entry->op = normal ? arith_op(normal) : ARITH_NONE;
+        eval_fuel = -1;
+        use_arith = true;
+        if (budget_tripped() != LIMIT_NONE) return ARITH_NONE; // not a verdict on the definition
+        entry->op_generation = env->generation;
+    }
+    return entry->op;
+}
+
+// A numeral operand: a NUM, or a numeral lambda including zero
+static Expr* arith_operand(Expr* expr)
+{
+    if (expr->type == EXPR_NUM) return expr;
+    if (expr->type != EXPR_ABS || abs_body(expr)->type != EXPR_ABS) return NULL;
+
+    Expr* num = as_numeral(expr);
+    if (num != expr) return num;
+    if (abs_body(abs_body(expr)) == mk_var(0)) return mk_num(0, expr->abs.param, abs_body(expr)->abs.param);
+    return NULL;
+}
+
+// Apply func to arg when func is a combinator, possibly holding its first
+// numeral already. NULL if func is something else.
+static Expr* apply_arith(Env* env, Expr* func, Expr* arg)
+{
+    Expr* global = func->type == EXPR_APP ? app_func(func) : func;
+    if (global->type != EXPR_VAR || global->var.index >= 0) return NULL;
+
+    ArithOp op = global_op(env, global->var.name);
+    if (op == ARITH_NONE || (func != global && arith_arity(op) == 1)) return NULL;
+
+    Expr* num = arith_operand(arg);
+    if (!num) return mk_app(func, arg); // stuck until arg is a numeral
+    if (func == global && arith_arity(op) == 2) return mk_app(func, num);
+
+    Expr* first = func == global ? num : arith_operand(app_arg(func));
+    if (!first) return mk_app(func, arg); // the first operand is stuck
+    // zero and overflow stay stuck, the final pass unfolds them so zero
+    // keeps the hints the combinator itself would give it
+    unsigned long n;
+    if (!arith_apply(op, first->num.value, num->num.value, &n) || n == 0) return mk_app(func, arg);
+    return mk_num(n, first->num.succ, first->num.zero);
+}
+
+// Give up on the frames above base, waiting for the workers they started
+static Expr* abandon(size_t base, size_t jobs_base)
+{
+    while (spawn_jobs.count > jobs_base)
+    {
+        Spawned job = stack_pop(spawn_jobs);
+        bool flag;
+        spawn_join(&job, &flag);
+    }
+    eval_work.count = base;
+    return NULL;
+}
+
+/*
+ * Collector for the substitution evaluator. Everything eval builds goes to
+ * eval_region, and beta steps leave most of it behind. Once the region has
+ * grown past gc_threshold nodes since the last collection, the outermost
+ * eval moves what is still reachable into a fresh region and drops the old
+ * one. The roots are the control term, the work stack and the memo table.
+ * Definitions live in env_region and are never moved. Nested evals (the
+ * look at a definition in global_op) never collect, their callers hold
+ * terms in locals.
+ */
+#define GC_MIN_NODES (1 << 16)
+
+static int eval_nesting = 0;
+static size_t gc_threshold = GC_MIN_NODES;
+static size_t gc_peak = 0;  // most nodes the region held before a collection
+
+static Expr* evacuate_visit(Expr* term, void* from)
+{
+    return region_evacuate(from, term);
+}
+
+static void collect_garbage(Expr** control)
+{
+    if (eval_region.count > gc_peak) gc_peak = eval_region.count;
+
+    Region to = { .parent = &env_region };
+    set_expr_region(&to);
+    *control = region_evacuate(&eval_region, *control);
+    for (size_t i = 0; i < eval_work.count; i++)
+    {
+        EvalFrame* frame = &eval_work.items[i];
+        frame->expr = region_evacuate(&eval_region, frame->expr);
+        if (frame->arg) frame->arg = region_evacuate(&eval_region, frame->arg);
+    }
+    memo_relocate(evacuate_visit, &eval_region);
+
+    to.arena.allocations += eval_region.arena.allocations;
+    to.allocated += eval_region.allocated;
+    free_region(&eval_region);
+    eval_region = to;
+    set_expr_region(&eval_region);
+
+    gc_threshold = eval_region.count * 2 > GC_MIN_NODES ? eval_region.count * 2 : GC_MIN_NODES;
+    stats.collections++;
+    if (trace_enabled) trace_collection(eval_region.count);
+}
+
+// Nodes the current expression held at most
+static size_t peak_nodes(void)
+{
+    return gc_peak > eval_region.count ? gc_peak : eval_region.count;
+}
+
+static Expr* eval_loop(Expr* expr, Env* env)
+{
+    size_t base = eval_work.count;
+    size_t jobs_base = spawn_jobs.count;
+    Expr* value = NULL;
+
+    for (;;)
+    {
+        // reduce the control expression until it yields a value
+        while (!value)
         {
-            Expr* val = env_lookup(env, expr->var.name);
-            if (!val)
+            switch (expr->type)
             {
-                //log_reduction(REDUCTION_DELTA, "expanding", expr);
-                return expr; // free var
+                case EXPR_VAR: 
+                {
+                    if (expr->var.index >= 0) // bound var
+                    {
+                        value = expr;
+                        break;
+                    }
+
+                    Expr* val = env_lookup(env, expr->var.name);
+                    if (!val)
+                    {
+                        //log_reduction(REDUCTION_DELTA, "expanding", expr);
+                        value = expr; // free var
+                        break;
+                    }
+                    if (global_op(env, expr->var.name) != ARITH_NONE)
+                    {
+                        arith_left = true;
+                        value = expr;
+                        break;
+                    }
+                    if (!budget_spend()) return abandon(base, jobs_base);
+                    log_reduction(REDUCTION_DELTA, "expanding", val);
+                    expr = val;
+                    break;
+                }
+                case EXPR_ABS: 
+                {
+                    // reduce the body, then rebuild the abstraction
+                    stack_push(eval_work, ((EvalFrame){ EVAL_FRAME_ABS, expr, NULL, false }));
+                    expr = abs_body(expr);
+                    break;
+                }
+                case EXPR_APP: 
+                {
+                    log_reduction(REDUCTION_NONE, "applying", expr);
+                    bool spawned = false;
+                    if (eval_fuel < 0 && spawn_worth(app_func(expr), app_arg(expr)))
+                    {
+                        // a worker normalises the argument while the function is done here
+                        Spawned job;
+                        int started = spawn_start(&job);
+                        if (started == 0)
+                        {
+                            arith_left = false;
+                            eval_nesting = 0; // the frames of the parent are never returned to
+                            spawn_finish(&job, eval(app_arg(expr), env), arith_left);
+                        }
+                        if (started > 0) stack_push(spawn_jobs, job);
+                        spawned = started > 0;
+                    }
+                    stack_push(eval_work, ((EvalFrame){ EVAL_FRAME_ARG, app_arg(expr), NULL, false, spawned }));
+                    expr = app_func(expr);
+                    break;
+                }
+                case EXPR_NUM:
+                {
+                    value = expr;
+                    break;
+                }
+                case EXPR_IMPORT:
+                {
+                    value = eval_module(expr, &global_env);
+                    break;
+                }
+                default:
+                    report_interp(DIAG_ERROR, "Unknown Expression Type");
             }
-            log_reduction(REDUCTION_DELTA, "expanding", val);
-            return val;
-        }
-        case EXPR_ABS: 
-        {
-            // recursive eval for nested exprs
-            Expr* reduced_body = eval(expr->abs.body, env);
-            Expr* new_abs = malloc(sizeof(Expr));
-            new_abs->type = EXPR_ABS;
-            new_abs->abs.param = strdup(expr->abs.param);
-            new_abs->abs.body = reduced_body;
-            return new_abs; // Defer eta reduction to avoid premature simplification
         }
-        case EXPR_APP: 
+
+        if (eval_work.count == base) return value;
+
+        stats_depth(eval_work.count);
+        EvalFrame frame = stack_pop(eval_work);
+        switch (frame.kind)
         {
-            log_reduction(REDUCTION_NONE, "applying", expr);
-            Expr* func = eval(expr->app.func, env);
-            
-            if (func->type != EXPR_ABS)
+            case EVAL_FRAME_ABS:
             {
-                Expr* arg = eval(expr->app.arg, env);
-                Expr* new_app = malloc(sizeof(Expr));
-                new_app->type = EXPR_APP;
-                new_app->app.func = copy_expr(func);
-                new_app->app.arg = copy_expr(arg);
-                return new_app; // Return application without further evaluation
+                // Defer eta reduction to avoid premature simplification
+                value = as_numeral(mk_abs(frame.expr->abs.param, value));
+                break;
             }
+            case EVAL_FRAME_ARG:
+                stack_push(eval_work, ((EvalFrame){ EVAL_FRAME_CALL, value, NULL, false }));
+                if (frame.spawned)
+                {
+                    Spawned job = stack_pop(spawn_jobs);
+                    bool flag = false;
+                    Expr* done = spawn_join(&job, &flag);
+                    if (done)
+                    {
+                        arith_left |= flag;
+                        value = done;
+                        break;
+                    }
+                    if (budget_tripped() != LIMIT_NONE) return abandon(base, jobs_base);
+                    // the worker failed, do it here
+                }
+                expr = frame.expr;
+                value = NULL;
+                break;
+            case EVAL_FRAME_CALL:
+            {
+                Expr* func = frame.expr;
+                if (func->type == EXPR_NUM) func = numeral_term(func);
 
-            Expr* arg = eval(expr->app.arg, env);
-            Expr* body = beta_reduce(func->abs.body, func->abs.param, arg);
-            log_reduction(REDUCTION_BETA, "reduced", body);
-            body = eta_reduction(body);
-            return eval(body, env); // Continue evaluation after beta reduction
-        }
-        case EXPR_IMPORT:
-        {
-            return eval_module(expr, &global_env);
+                Expr* computed = apply_arith(env, func, value);
+                if (computed)
+                {
+                    value = computed;
+                    if (value->type == EXPR_NUM) log_reduction(REDUCTION_ARITH, "computed", value);
+                    break;
+                }
+
+                if (func->type != EXPR_ABS)
+                {
+                    value = mk_app(func, value); // Return application without further evaluation
+                    break;
+                }
+
+                bool memoize = use_arith && memo_enabled();
+                if (memoize)
+                {
+                    bool arith;
+                    Expr* known = memo_lookup(func, value, &arith);
+                    if (known)
+                    {
+                        arith_left |= arith;
+                        value = known;
+                        break;
+                    }
+                }
+
+                if (eval_fuel == 0 || !budget_spend()) return abandon(base, jobs_base);
+                if (eval_fuel > 0) eval_fuel--;
+
+                // a call in tail position of a memoized one is not remembered
+                // separately, so loops do not grow the stack
+                if (memoize && (eval_work.count == base || stack_top(eval_work).kind != EVAL_FRAME_MEMO))
+                {
+                    stack_push(eval_work, ((EvalFrame){ EVAL_FRAME_MEMO, func, value, arith_left }));
+                    arith_left = false;
+                }
+
+                Expr* body = beta_reduce(abs_body(func), value);
+                log_reduction(REDUCTION_BETA, "reduced", body);
+                expr = eta_reduction(body); // Continue evaluation after beta reduction
+                value = NULL;
+                if (eval_nesting == 1 && eval_region.count > gc_threshold && get_expr_region() == &eval_region)
+                {
+                    collect_garbage(&expr);
+                }
+                break;
+            }
+            case EVAL_FRAME_MEMO:
+                memo_store(frame.expr, frame.arg, value, arith_left);
+                arith_left |= frame.arith;
+                break;
         }
-        default:
-            report_interp(DIAG_ERROR, "Unknown Expression Type");
     }
-    assert(0 && "Unreachable");
+}
+
+Expr* eval(Expr* expr, Env* env)
+{
+    eval_nesting++;
+    Expr* value = eval_loop(expr, env);
+    eval_nesting--;
+    return value;
 }
 
 Expr* eta_reduction(Expr* expr)
 {
     if (expr->type == EXPR_ABS)
     {
-        Expr* body = expr->abs.body;
-        if (body->type == EXPR_APP && body->app.arg->type == EXPR_VAR &&
-            strcmp(body->app.arg->var.name, expr->abs.param) == 0 && 
-            !is_free_in(expr->abs.param, body->app.func) &&
-            body->app.func->type == EXPR_ABS) // Only reduce if func is an abstraction
+        Expr* body = abs_body(expr);
+        if (body->type == EXPR_APP && app_arg(body)->type == EXPR_VAR &&
+            app_arg(body)->var.index == 0 &&
+            !is_free_in(0, app_func(body)) &&
+            app_func(body)->type == EXPR_ABS) // Only reduce if func is an abstraction
         {
-            log_reduction(REDUCTION_ETA, "eta reduced", body->app.func);
-            return copy_expr(body->app.func);
+            log_reduction(REDUCTION_ETA, "eta reduced", app_func(body));
+            return shift_expr(app_func(body), -1, 0);
         }
     }
     return expr;
 }
 
-Expr* alpha_conversion(Expr* expr, const char* old_name, const char* new_name)
+static Expr* shift_visit(Expr* node, int cutoff, void* ctx)
 {
-    switch (expr->type)
+    int amount = *(int*)ctx;
+    if (node->free_bound <= (unsigned)cutoff) return node; // nothing to move in here
+    switch (node->type)
     {
         case EXPR_VAR:
-        {
-            if (strcmp(expr->var.name, old_name) == 0)
-            {
-                Expr* new_var = malloc(sizeof(Expr));
-                new_var->type = EXPR_VAR;
-                new_var->var.name = strdup(new_name);
-                return new_var;
-            }
-            return expr;
-        }
+            if (node->var.index < cutoff) return node;
+            return mk_var(node->var.index + amount);
         case EXPR_ABS:
-        {
-            Expr* new_abs = malloc(sizeof(Expr));
-            new_abs->type = EXPR_ABS;
-            if (strcmp(expr->abs.param, old_name) == 0)
-            {
-                new_abs->abs.param = strdup(new_name);
-                new_abs->abs.body = alpha_conversion(expr->abs.body, old_name, new_name);
-            }
-            else
-            {
-                new_abs->abs.param = strdup(expr->abs.param);
-                new_abs->abs.body = alpha_conversion(expr->abs.body, old_name, new_name);
-            }
-            return new_abs;
-        }
         case EXPR_APP:
-        {
-            Expr* new_app = malloc(sizeof(Expr));
-            new_app->type = EXPR_APP;
-            new_app->app.func = alpha_conversion(expr->app.func, old_name, new_name);
-            new_app->app.arg = alpha_conversion(expr->app.arg, old_name, new_name);
-            return new_app;
-        }
+            return NULL;
         default:
-        {
-            return expr;
-        }
+            return node;
     }
 }
 
-Expr* beta_reduce(Expr* body, const char* var, Expr* value)
+// Copy of expr with every index referring outside of `cutoff` binders moved by amount
+Expr* shift_expr(Expr* expr, int amount, int cutoff)
 {
+    return rebuild(expr, cutoff, shift_visit, &amount);
+}
+
+// Replace index `depth` in body with value, closing the gap left by the removed binder
+static Expr* substitute_visit(Expr* body, int depth, void* ctx)
+{
+    Expr* value = ctx;
+    if (body->free_bound <= (unsigned)depth) return body; // neither the variable nor anything above it
     switch (body->type)
     {
         case EXPR_VAR: 
         {
-            if (strcmp(body->var.name, var) == 0)
-            {
-                return copy_expr(value);
-            }
-            else 
-            {
-                Expr* copy = malloc(sizeof(Expr));
-                if (!copy)
-                {
-                    report_interp(DIAG_ERROR, "Memory allocation failed");
-                    return NULL;
-                }
-                copy->type = EXPR_VAR;
-                copy->var.name = strdup(body->var.name);
-                return copy;
-            }
+            if (body->var.index == depth) return shift_expr(value, depth, 0);
+            if (body->var.index < depth) return body;
+            return mk_var(body->var.index - 1);
         }
         case EXPR_ABS: 
-        {
-            if (strcmp(body->abs.param, var) == 0)
-            {
-                return body;  // shadowed, skip substitution
-            }
-            else if (is_free_in(body->abs.param, value)) 
-            {
-                char new_name[64];
-                snprintf(new_name, sizeof(new_name), "%s_", body->abs.param);
-                Expr* renamed_body = alpha_conversion(body->abs.body, body->abs.param, new_name);
-                log_reduction(CONVERSION_ALPHA, "renamed variables", renamed_body);
-                Expr* new_abs = malloc(sizeof(Expr));
-                new_abs->type = EXPR_ABS;
-                new_abs->abs.param = strdup(new_name);
-                new_abs->abs.body = beta_reduce(renamed_body, var, value);
-                //free_expr(renamed_body);
-                return new_abs;
-            }
-            else
-            {
-                Expr* new_body = beta_reduce(body->abs.body, var, value);
-                Expr* new_abs = malloc(sizeof(Expr));
-                new_abs->type = EXPR_ABS;
-                new_abs->abs.param = strdup(body->abs.param);
-                new_abs->abs.body = new_body;
-                return new_abs;
-            }
-        }
         case EXPR_APP:
+            return NULL;
+        default:
+            return body;
+    }
+}
+
+// body is the body of an abstraction, value is substituted for its bound variable (index 0)
+Expr* beta_reduce(Expr* body, Expr* value)
+{
+    return rebuild(body, 0, substitute_visit, value);
+}
+
+void set_eval_mode(EvalMode mode)
+{
+    eval_mode = mode;
+}
+
+size_t eval_allocations(void)
+{
+    return env_region.arena.allocations + env_region.allocated +
+           eval_region.arena.allocations + eval_region.allocated;
+}
+
+bool parse_eval_mode(const char* name, EvalMode* mode)
+{
+    if (strcmp(name, "subst") == 0) *mode = EVAL_SUBST;
+    else if (strcmp(name, "cek") == 0) *mode = EVAL_CEK;
+    else if (strcmp(name, "need") == 0) *mode = EVAL_NEED;
+    else if (strcmp(name, "vm") == 0) *mode = EVAL_VM;
+    else if (strcmp(name, "net") == 0) *mode = EVAL_NET;
+    else return false;
+    return true;
+}
+
+void set_show_stats(bool show)
+{
+    show_stats = show;
+}
+
+void set_eval_threads(int threads)
+{
+    eval_threads = threads;
+}
+
+void set_eval_jobs(int jobs)
+{
+    eval_jobs = jobs;
+}
+
+static int worker_count(void)
+{
+    if (trace_enabled) return 1; // the trace ring takes events from one thread
+    if (eval_threads > 0) return eval_threads;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
+
+static Expr* evaluate(Expr* expr)
+{
+    if (expr->type == EXPR_IMPORT) return eval_module(expr, &global_env);
+
+    switch (eval_mode)
+    {
+        case EVAL_CEK:
+            return machine_normalise(expr, global_env, STRATEGY_CBV);
+        case EVAL_NEED:
+            return machine_normalise(expr, global_env, STRATEGY_NEED);
+        case EVAL_VM:
+            return vm_normalise(expr, global_env);
+        case EVAL_NET:
         {
-            Expr* new_func = beta_reduce(body->app.func, var, value);
-            Expr* new_arg = beta_reduce(body->app.arg, var, value);
-            Expr* new_app = malloc(sizeof(Expr));
-            new_app->type = EXPR_APP;
-            new_app->app.func = new_func;
-            new_app->app.arg = new_arg;
-            return new_app;
+            Expr* result = net_normalise(expr, global_env, worker_count());
+            if (result || budget_tripped() != LIMIT_NONE) return result;
+            report_interp(DIAG_WARNING, "Interaction net gave no result, using the closure machine");
+            return machine_normalise(expr, global_env, STRATEGY_CBV);
         }
+        case EVAL_SUBST:
         default:
         {
-            return body;
+            arith_left = false;
+            Expr* result = eval(expr, global_env);
+            if (!result || !arith_left) return result;
+            // finish arithmetic that never met numerals on the lambda forms
+            use_arith = false;
+            result = eval(result, global_env);
+            use_arith = true;
+            return result;
         }
     }
 }
 
-void interpret(ExprStream* stream)
+static void interpret_one(TokenStream* tokens)
 {
-    if (global_env == NULL) {
-        global_env = NULL;
-    }
+    set_expr_region(&eval_region);
+
+    int pos = 0;
+    Expr* expr = parse_expression(*tokens, &pos);
+    
+    LOG_TREE(expr); 
 
-    for (int i = 0; i < stream->count; ++i)
+    if (!expr) return;
+
+    if (expr->type == EXPR_DEF)
     {
-        int pos = 0;
-        Expr* expr = parse_expression(*stream->expressions[i], &pos);
+        env_add(&global_env, expr->def.name, expr->def.value);
+    }
+    else 
+    {
+        budget_start(&eval_region);
+        spawn_rearm();
+        reset_stats();
+        trace_next_expression();
+        memo_clear(); // entries point into eval_region
+        gc_threshold = GC_MIN_NODES;
+        gc_peak = 0;
+        unsigned long steps = budget_steps();
+        Expr* result = evaluate(expr);
+        if (!result && budget_tripped() != LIMIT_NONE)
+        {
+            // a limit tripped, give up on this expression only
+            report_interp(DIAG_WARNING, limit_message(budget_tripped()));
+            reset_region(&eval_region);
+            return;
+        }
+        
+        LOG_TREE(result);
         
-        LOG_TREE(expr); 
+        print_expr(result); printf("\n");
+        if (show_stats && result) print_stats(budget_steps() - steps, peak_nodes());
+        printf("\n");
+    }
 
-        if (!expr) continue;
+    // release the parse tree, intermediates and result in one go
+    reset_region(&eval_region);
+}
 
-        if (expr->type == EXPR_DEF)
+// Definitions and imports change the env, everything else only reads it
+static bool is_query(const TokenStream* tokens)
+{
+    const Token* t = tokens->tokens;
+    if (tokens->count == 0 || t[0].type == TOKEN_IMPORT) return false;
+    return !(t[0].type == TOKEN_IDENT && tokens->count > 1 && t[1].type == TOKEN_DEF);
+}
+
+// Where a query's printed output ended up
+typedef struct {
+    int worker;     // -1 until evaluated
+    off_t start;
+    off_t end;
+} JobOutput;
+
+typedef struct {
+    atomic_size_t next;
+    JobOutput outputs[];
+} JobBoard;
+
+/*
+ * Evaluates the queries [first, last) in forked workers. A child sees the
+ * global env as it was at the fork, so definitions further down cannot leak
+ * in, and its own caches, hash-consing tables and counters are private.
+ * Workers claim queries from a shared counter and print into a temp file of
+ * their own, the output is then copied to stdout in source order. Queries a
+ * worker did not finish, e.g. because it crashed, are evaluated here.
+ */
+static void interpret_parallel(ExprStream* stream, size_t first, size_t last, int jobs)
+{
+    size_t count = last - first;
+    size_t board_size = sizeof(JobBoard) + count * sizeof(JobOutput);
+    JobBoard* board = mmap(NULL, board_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (board == MAP_FAILED) {
+        for (size_t i = first; i < last; i++) interpret_one(stream->expressions[i]);
+        return;
+    }
+    atomic_init(&board->next, 0);
+    for (size_t i = 0; i < count; i++) board->outputs[i].worker = -1;
+
+    FILE** files = calloc(jobs, sizeof(FILE*));
+    pid_t* pids = calloc(jobs, sizeof(pid_t));
+    if (!files || !pids) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    fflush(stdout); // or the children print it again
+    fflush(stderr);
+    int started = 0;
+    for (; started < jobs; started++) {
+        files[started] = tmpfile();
+        if (!files[started]) break;
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            fclose(files[started]);
+            break;
+        }
+        if (pid == 0) {
+            dup2(fileno(files[started]), STDOUT_FILENO);
+            size_t i;
+            while ((i = atomic_fetch_add(&board->next, 1)) < count) {
+                off_t start = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+                interpret_one(stream->expressions[first + i]);
+                fflush(stdout);
+                board->outputs[i] = (JobOutput){ started, start, lseek(STDOUT_FILENO, 0, SEEK_CUR) };
+            }
+            fflush(stderr);
+            _exit(0);
+        }
+        pids[started] = pid;
+    }
+    for (int w = 0; w < started; w++) waitpid(pids[w], NULL, 0);
+
+    char buffer[4096];
+    for (size_t i = 0; i < count; i++) {
+        JobOutput out = board->outputs[i];
+        if (out.worker < 0) {
+            interpret_one(stream->expressions[first + i]);
+            continue;
+        }
+        int fd = fileno(files[out.worker]);
+        for (off_t at = out.start; at < out.end; ) {
+            size_t want = out.end - at < (off_t)sizeof(buffer) ? (size_t)(out.end - at) : sizeof(buffer);
+            ssize_t got = pread(fd, buffer, want, at);
+            if (got <= 0) break;
+            fwrite(buffer, 1, got, stdout);
+            at += got;
+        }
+    }
+
+    for (int w = 0; w < started; w++) fclose(files[w]);
+    free(files);
+    free(pids);
+    munmap(board, board_size);
+}
+
+void interpret(ExprStream* stream)
+{
+    // the trace flush thread does not survive a fork
+    int jobs = trace_enabled ? 1 : eval_jobs;
+
+    size_t i = 0;
+    while (i < stream->count)
+    {
+        size_t run = i;
+        if (jobs > 1) while (run < stream->count && is_query(stream->expressions[run])) run++;
+
+        if (run - i > 1)
         {
-            env_add(&global_env, expr->def.name, expr->def.value);
+            int workers = run - i < (size_t)jobs ? (int)(run - i) : jobs;
+            interpret_parallel(stream, i, run, workers);
+            i = run;
         }
-        else 
+        else
         {
-            Expr* result = eval(expr, global_env);
-            
-            LOG_TREE(result);
-            
-            print_expr(result); printf("\n\n");
-
-            free_expr(expr);
-            free_expr(result); // Free the result to prevent memory leaks
+            interpret_one(stream->expressions[i++]);
         }
     }
 }
+
+void interpret_file(const char* path)
+{
+    Source source;
+    int invalid;
+    if (!read_source(path, &source, &invalid))
+    {
+        fprintf(stderr, "Failed to Open File \n");
+        exit(1);
+    }
+    for (int i = 0; i < invalid; i++) fprintf(stderr, "Failed to tokenize input\n");
+    set_current_file_path(path);
+
+    interpret(&source.exprs);
+    free_source(&source);
+}
+
+void interpret_line(const char* line)
+{
+    TokenStream tokens = tokenise(line);
+    if (tokens.tokens == NULL)
+    {
+        fprintf(stderr, "Failed to tokenize input\n");
+        return;
+    }
+
+    ExprStream single_expr = {0};
+    TokenStream* heap_tokens = malloc(sizeof(TokenStream));
+    if (!heap_tokens)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    *heap_tokens = tokens;
+    da_append(single_expr, heap_tokens);
+
+    interpret(&single_expr);
+
+    free_token_stream(&tokens);
+    free(heap_tokens);
+    free(single_expr.expressions);
+}
@@ -1,16 +1,37 @@
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
 
+#include <stdbool.h>
+
 #include "parser.h"
+#include "numeral.h"
 #include "debug.h"
 
-// Linked List of Entries to the Symbol Table
-typedef struct EnvEntry {
-    const char* name;
+typedef struct {
+    Symbol name;
     Expr* value;
-    struct EnvEntry* next;
+    ArithOp op;             // combinator the value normalises to, see numeral.h
+    unsigned op_generation; // env generation op was worked out in, 0 if never
+} EnvEntry;
+
+// Symbol Table of global definitions, open addressing keyed by symbol id.
+// Redefining a name replaces its entry, so the latest definition shadows.
+typedef struct {
+    EnvEntry* entries;
+    size_t capacity;
+    size_t count;
+    unsigned generation;    // bumped by every definition
 } Env;
 
+// Evaluation backend used by interpret()
+typedef enum {
+    EVAL_SUBST,   // substitution based tree rewriting (eval)
+    EVAL_CEK,     // closure machine, see machine.h
+    EVAL_NEED,    // closure machine with call-by-need arguments
+    EVAL_VM,      // bytecode compiler and virtual machine, see vm.h
+    EVAL_NET,     // parallel interaction net reduction, see net.h
+} EvalMode;
+
 typedef struct {
   TokenStream** expressions;
   size_t count;
@@ -30,36 +51,38 @@ typedef struct {
 // Create a Symbol Table
 
 /*
- * (\x . x y)       -- x is bound, y is free 
- *    | alpha convert
- *    v
- * (\z . z y)   == (\y . y x)
+ * Terms are evaluated in De Bruijn form, so no alpha conversion is needed:
+ *
+ * (\x . x y)       -- x is bound (index 0), y is free (looked up by name)
+ * (\z . z y)       -- the same term, (\ . 0 y)
  */
 
 void log_reduction(ReductionType type, const char* label, Expr* expr);
 
-void env_add(Env** env, const char* name, Expr* value);
-Expr* env_lookup(Env* env, const char* name);
+void env_add(Env** env, Symbol name, Expr* value);
+Expr* env_lookup(Env* env, Symbol name);
 void free_env(Env* env);
 
+void set_eval_mode(EvalMode mode);
+bool parse_eval_mode(const char* name, EvalMode* mode); // "subst", "cek", ...
+void set_eval_threads(int threads);
+void set_eval_jobs(int jobs);   // > 1 evaluates runs of independent expressions in that many processes
+void set_show_stats(bool show); // print work counters after each result
+size_t eval_allocations(void); // terms and values allocated so far
 void interpret(ExprStream* stream);
+void interpret_file(const char* path);   // read and run a .l file
+void interpret_line(const char* line);   // run one line, as typed at the REPL
 Expr* eval(Expr* expr, Env* env);
 void read_module(Expr* expr, Env* env);
 Expr* eval_module(Expr* expr, Env** env);
 Expr* copy_expr(Expr* expr);
 
 // Set the current file being interpreted, used for resolving relative imports
-char* resolve_relative_path(const char* current_file_path, const char* import_filename);
 void set_current_file_path(const char* path);
-bool file_is_readable(const char* path);
-char* join_path(const char* a, const char* b);
-bool ends_with(const char* s, const char* suffix);
-char* with_ext(const char* filename, const char* new_ext);
-static char* resolve_import_path(const char* import_filename);
 
-Expr* beta_reduce(Expr* body, const char* var, Expr* value);
-Expr* alpha_conversion(Expr* expr, const char* old_name, const char* new_name);
-bool is_free_in(const char* name, Expr* expr);
+Expr* shift_expr(Expr* expr, int amount, int cutoff);
+Expr* beta_reduce(Expr* body, Expr* value);
+bool is_free_in(int index, Expr* expr);
 Expr* eta_reduction(Expr* expr);
 
 #endif
@@ -32,7 +32,13 @@ return "identifier";
 }
 
 
-Token next_token(const char** input)
+// Reads past `end` see '\0', so a mapped file needs no terminator
+static inline char peek(const char* p, const char* end)
+{
+  return p < end ? *p : '\0';
+}
+
+Token next_token(const char** input, const char* end)
 {
   if (input == NULL || *input == NULL) {
     fprintf(stderr, "Error: Invalid input pointer\n");
@@ -40,21 +46,21 @@ Token next_token(const char** input)
   }
 
   while (1) {
-    // Skip whitespace
-    while (**input == ' ' || **input == '\t' || **input == '\n')
+    // Skip whitespace, new lines are tokens of their own
+    while (peek(*input, end) == ' ' || peek(*input, end) == '\t' || peek(*input, end) == '\r')
       (*input)++;
 
     // Skip comments (e.g. -- this is a comment)
-    if (**input == '-' && (*input)[1] == '-') {
+    if (peek(*input, end) == '-' && peek(*input + 1, end) == '-') {
       *input += 2;
-      while (**input && **input != '\n') (*input)++;
+      while (peek(*input, end) && peek(*input, end) != '\n') (*input)++;
       continue; // re-check for whitespace/comments
     }
 
     break; // Exit loop if no more whitespace/comments
   }
 
-  char c = **input;
+  char c = peek(*input, end);
 
   if (c == '\0') 
   {
@@ -66,45 +72,44 @@ Token next_token(const char** input)
     (*input)++; // skip #
 
     const char* keyword_start = *input;
-    while (isalpha(**input)) (*input)++;
+    while (isalpha(peek(*input, end))) (*input)++;
     int kw_len = *input - keyword_start;
 
     if (kw_len == 6 && strncmp(keyword_start, "import", 6) == 0)
     {
-      while (**input == ' ' || **input == '\t') (*input)++;
+      while (peek(*input, end) == ' ' || peek(*input, end) == '\t') (*input)++;
 
-      if (**input == '"' || **input == '\'') // skip quotes
+      if (peek(*input, end) == '"' || peek(*input, end) == '\'') // skip quotes
       {
         const char quote_type = **input;
 
         (*input)++;
         const char* filename_start = *input;
 
-        while (**input && **input != quote_type) (*input)++; // advance part the string
+        while (peek(*input, end) && peek(*input, end) != quote_type) (*input)++; // advance part the string
         
         const int len = *input - filename_start;
         
-        if (**input != quote_type) 
+        if (peek(*input, end) != quote_type) 
         {
           char msg[100];
           snprintf(msg, sizeof(msg), "Unterminated Import string, expected `%c`", quote_type);
           report_diag(DIAG_ERROR, len, msg);
         }
+        else
+        {
+          (*input)++; // skip closing quote 
+        }
 
-        char* filename = malloc(len + 1);
-        strncpy(filename, filename_start, len);
-        filename[len] = '\0';
-
-        (*input)++; // skip closing quote 
-        return (Token){ .type = TOKEN_IMPORT, .value = filename};
+        return (Token){ .type = TOKEN_IMPORT, .text = filename_start, .length = len };
       }
     }
   }
 
-  if (c == ':' && (*input)[1] == '=') 
+  if (c == ':' && peek(*input + 1, end) == '=') 
   {
     *input += 2; // move past +=
-    return (Token){ .type = TOKEN_DEF, .value = 0 };
+    return (Token){ .type = TOKEN_DEF };
   }
  
   // Single-character tokens
@@ -132,29 +137,45 @@ Token next_token(const char** input)
   if (isalpha(c))
   {
     const char* start = *input;
-    while (isalnum(**input) || **input == '_') (*input)++;
+    while (isalnum(peek(*input, end)) || peek(*input, end) == '_') (*input)++;
     int len = *input - start;
 
-    char* ident = malloc(len + 1);
-    strncpy(ident, start, len);
-    ident[len] = '\0';
-
-
-    return (Token){ .type = TOKEN_IDENT, .value = ident };
+    return (Token){ .type = TOKEN_IDENT, .text = start, .length = len };
   }
  
 
   // Unknown Tokens 
   (*input)++;
-  return (Token){ .type = TOKEN_INVALID, .value = NULL };
+  return (Token){ .type = TOKEN_INVALID, .text = *input - 1, .length = 1 };
+}
+
+static void report_invalid(Token tok)
+{
+  fprintf(stderr, "Invalid Token: '%.*s'\n", tok.length, tok.text);
+}
+
+static void push_token(Token** tokens, int* size, int* capacity, Token tok)
+{
+  // Grow array if needed 
+  if (*size >= *capacity)
+  {
+    *capacity *= 2;
+    *tokens = realloc(*tokens, *capacity * sizeof(Token));
+    if (!*tokens)
+    {
+      fprintf(stderr, "Memory reallocation failed\n");
+      exit(1);
+    }
+  }
+  (*tokens)[(*size)++] = tok;
 }
 
 TokenStream tokenise(const char* input)
 {
   const char* cursor = input;
+  const char* end = input + strlen(input);
   int capacity = INITIAL_CAPACITY;
   int size = 0;
-  int count = 0;
 
   Token* tokens = malloc(capacity * sizeof(Token));
   if (!tokens) {
@@ -164,54 +185,98 @@ TokenStream tokenise(const char* input)
 
   while (1)
   {
-    Token tok = next_token(&cursor);
+    Token tok = next_token(&cursor, end);
+    if (tok.type == TOKEN_EOE) continue; // a line is a single expression
+
+    push_token(&tokens, &size, &capacity, tok);
 
-    // Grow array if needed 
-    if (size >= capacity)
+    if (tok.type == TOKEN_EOF) break;
+
+    if (tok.type == TOKEN_INVALID)
     {
-      capacity *= 2;
-      tokens = realloc(tokens, capacity * sizeof(Token));
-      if (!tokens)
-      {
-        fprintf(stderr, "Memory reallocation failed\n");
-        exit(1);
-      }
+      report_invalid(tok);
+      free(tokens);
+      return (TokenStream){0,0};
     }
+  }
+  return (TokenStream){tokens, size};
+}
+
+// A new line inside parentheses or after `:=`, `\` or `.` continues the expression
+static bool continues(int depth, TokenType last)
+{
+  return depth > 0 || last == TOKEN_DEF || last == TOKEN_LAMBDA || last == TOKEN_DOT;
+}
 
-    tokens[size++] = tok;
-    count++;
+TokenStream tokenise_source(const char* input, size_t length, int* invalid)
+{
+  const char* cursor = input;
+  const char* end = input + length;
+  int capacity = INITIAL_CAPACITY;
+  int size = 0;
+  *invalid = 0;
 
-    if (tok.type == TOKEN_EOF) break;
+  Token* tokens = malloc(capacity * sizeof(Token));
+  if (!tokens) {
+    fprintf(stderr, "Memory allocation failed\n");
+    exit(1);
+  }
 
-    if (tok.type == TOKEN_INVALID)
+  int start = 0;          // first token of the current expression
+  int depth = 0;
+  TokenType last = TOKEN_EOE;
+  bool bad = false;       // the current expression had an invalid token
+  while (1)
+  {
+    Token tok = next_token(&cursor, end);
+
+    if (tok.type == TOKEN_EOE || tok.type == TOKEN_EOF)
     {
-      if (tok.value != NULL)
+      bool empty = size == start && !bad;
+      if (tok.type == TOKEN_EOE && (empty || continues(depth, last))) continue;
+
+      if (bad)
       {
-        fprintf(stderr, "Invalid Token: '%s'\n", tok.value);
+        size = start; // drop the whole expression
+        (*invalid)++;
       }
-      else
+      else if (!empty)
       {
-        fprintf(stderr, "Invalid Token (no value)\n");
-      } 
-      free(tokens);
-      return (TokenStream){0,0};
+        push_token(&tokens, &size, &capacity, (Token){ TOKEN_EOF, NULL });
+      }
+      if (tok.type == TOKEN_EOF) break;
+
+      start = size;
+      depth = 0;
+      last = TOKEN_EOE;
+      bad = false;
+      continue;
+    }
+
+    if (tok.type == TOKEN_INVALID && !bad)
+    {
+      report_invalid(tok);
+      bad = true;
     }
+    if (tok.type == TOKEN_LPAREN) depth++;
+    if (tok.type == TOKEN_RPAREN && depth > 0) depth--;
+    last = tok.type;
+
+    if (!bad) push_token(&tokens, &size, &capacity, tok);
   }
-  return (TokenStream){tokens, count};
+  return (TokenStream){tokens, size};
+}
+
+Symbol token_symbol(Token token)
+{
+  return intern(token.text, token.length);
 }
 
 void free_token_stream(TokenStream* stream)
 {
   if (!stream || !stream->tokens) return;
   
-  // Free all token values
-  for (int i = 0; i < stream->count; i++) {
-    if (stream->tokens[i].value) {
-      free(stream->tokens[i].value);
-    }
-  }
-  
-  // Free the tokens array
+  // Tokens only point into the source, the array is all there is to free
   free(stream->tokens);
   stream->tokens = NULL;
   stream->count = 0;
@@ -2,9 +2,12 @@
 #define LEXER_H
 
 #include <ctype.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "symbol.h"
+
 #define INITIAL_CAPACITY 64
 typedef enum 
 {
@@ -21,10 +24,12 @@ typedef enum
 } TokenType;
 
 
+// Tokens are views into the source text, which has to outlive them
 typedef struct 
 {
   TokenType type;
-  char* value;
+  const char* text;  // identifier, or import filename without its quotes
+  int length;
 } Token;
 
 typedef struct 
@@ -33,9 +38,15 @@ typedef struct
   int count;
 } TokenStream;
 
-Token next_token(const char** line);
+Token next_token(const char** input, const char* end);
 TokenStream tokenise(const char* input);
+
+// Every expression of a source file, each terminated by TOKEN_EOF. New lines
+// only end an expression where the grammar allows it to end, expressions
+// with invalid tokens are dropped and counted in `invalid`.
+TokenStream tokenise_source(const char* input, size_t length, int* invalid);
 char* token_as_string(TokenType type);
+Symbol token_symbol(Token token);  // interns an identifier
 void free_token_stream(TokenStream* stream);
 
 #endif // LEXER_H
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "machine.h"
+#include "budget.h"
+#include "stats.h"
+#include "diagnostics.h"
+#include "debug.h"
+#include "stack.h"
+
+typedef enum {
+    FRAME_ARG,     // evaluate the argument of an application next (cbv)
+    FRAME_CALL,    // apply a function value to the value just computed (cbv)
+    FRAME_APPLY,   // apply the value just computed to a thunk (need)
+    FRAME_UPDATE,  // store the value just computed in a forced thunk
+} FrameKind;
+
+typedef struct {
+    FrameKind kind;
+    Expr* term;
+    MEnv* env;
+    Value* func;
+    Thunk* thunk;
+} Frame;
+
+// Continuation stack, shared by nested runs started from read back
+static struct { Frame* items; size_t count; size_t capacity; } stack = {0};
+
+#define push_frame(...) stack_push(stack, (__VA_ARGS__))
+
+// Values and environments live as long as the terms of the current region
+static Value* new_value(ValueKind kind)
+{
+    Value* value = arena_alloc(&get_expr_region()->arena, sizeof(Value));
+    value->kind = kind;
+    return value;
+}
+
+static Thunk* new_thunk(Expr* term, MEnv* env, Value* value)
+{
+    Thunk* thunk = arena_alloc(&get_expr_region()->arena, sizeof(Thunk));
+    thunk->term = term;
+    thunk->env = env;
+    thunk->value = value;
+    return thunk;
+}
+
+static MEnv* extend(Thunk* thunk, MEnv* env)
+{
+    MEnv* entry = arena_alloc(&get_expr_region()->arena, sizeof(MEnv));
+    entry->thunk = thunk;
+    entry->next = env;
+    return entry;
+}
+
+Value* machine_eval(Expr* expr, MEnv* env, Env* globals, Strategy strategy)
+{
+    size_t base = stack.count;
+    Expr* term = expr;
+    Value* value = NULL;
+
+    for (;;) {
+        // run the control term until it produces a value
+        while (!value) {
+            switch (term->type) {
+                case EXPR_VAR:
+                {
+                    if (term->var.index >= 0) {
+                        MEnv* entry = env;
+                        for (int i = 0; i < term->var.index; i++) entry = entry->next;
+                        Thunk* thunk = entry->thunk;
+                        if (thunk->value) {
+                            value = thunk->value;
+                        } else {
+                            push_frame((Frame){ .kind = FRAME_UPDATE, .thunk = thunk });
+                            term = thunk->term;
+                            env = thunk->env;
+                        }
+                        break;
+                    }
+
+                    Expr* def = env_lookup(globals, term->var.name);
+                    if (def && !budget_spend()) {
+                        stack.count = base;
+                        return NULL;
+                    }
+                    if (def) {
+                        log_reduction(REDUCTION_DELTA, "expanding", def);
+                        term = def;  // definitions are closed
+                        env = NULL;
+                    } else {
+                        value = new_value(VALUE_FREE);
+                        value->name = term->var.name;
+                    }
+                    break;
+                }
+                case EXPR_ABS:
+                    value = new_value(VALUE_CLOSURE);
+                    value->closure.abs = term;
+                    value->closure.env = env;
+                    break;
+                case EXPR_APP:
+                {
+                    Expr* arg = app_arg(term);
+                    if (strategy == STRATEGY_CBV) {
+                        push_frame((Frame){ .kind = FRAME_ARG, .term = arg, .env = env });
+                    } else if (arg->type == EXPR_VAR && arg->var.index >= 0) {
+                        // pass the variable's own thunk on, so it is still forced only once
+                        MEnv* entry = env;
+                        for (int i = 0; i < arg->var.index; i++) entry = entry->next;
+                        push_frame((Frame){ .kind = FRAME_APPLY, .thunk = entry->thunk });
+                    } else {
+                        push_frame((Frame){ .kind = FRAME_APPLY, .thunk = new_thunk(arg, env, NULL) });
+                    }
+                    term = app_func(term);
+                    break;
+                }
+                default:
+                    report_interp(DIAG_ERROR, "Unknown Expression Type");
+            }
+        }
+
+        if (stack.count == base) return value;
+
+        stats_depth(stack.count);
+        Frame frame = stack_pop(stack);
+        Value* func = NULL;
+        Thunk* arg = NULL;
+        switch (frame.kind) {
+            case FRAME_ARG:
+                push_frame((Frame){ .kind = FRAME_CALL, .func = value });
+                term = frame.term;
+                env = frame.env;
+                value = NULL;
+                continue;
+            case FRAME_UPDATE:
+                frame.thunk->value = value;
+                frame.thunk->env = NULL; // the environment is no longer needed
+                continue;
+            case FRAME_CALL:
+                func = frame.func;
+                arg = new_thunk(NULL, NULL, value);
+                break;
+            case FRAME_APPLY:
+                func = value;
+                arg = frame.thunk;
+                break;
+        }
+
+        if (func->kind == VALUE_CLOSURE) {
+            if (!budget_spend()) {
+                stack.count = base;
+                return NULL;
+            }
+            Expr* abs = func->closure.abs;
+            log_reduction(REDUCTION_BETA, "entering", abs);
+            env = extend(arg, func->closure.env);
+            term = abs_body(abs);
+            value = NULL;
+        } else {
+            value = new_value(VALUE_APP);
+            value->app.func = func;
+            value->app.arg = arg;
+        }
+    }
+}
+
+static Value* force(Thunk* thunk, Env* globals, Strategy strategy)
+{
+    if (!thunk->value) {
+        thunk->value = machine_eval(thunk->term, thunk->env, globals, strategy);
+        thunk->env = NULL;
+    }
+    return thunk->value;
+}
+
+typedef struct {
+    Value* value;   // value to read back, or NULL to build from results
+    Expr* abs;      // when building: abstraction to rebuild, NULL for an application
+    int depth;
+} ReadFrame;
+
+static struct { ReadFrame* items; size_t count; size_t capacity; } read_work = {0};
+static struct { Expr** items; size_t count; size_t capacity; } read_results = {0};
+
+Expr* machine_readback(Value* value, int depth, Env* globals, Strategy strategy)
+{
+    if (!value) return NULL;
+
+    size_t base = read_work.count;
+    size_t results_base = read_results.count;
+    stack_push(read_work, ((ReadFrame){ value, NULL, depth }));
+
+    while (read_work.count > base) {
+        ReadFrame frame = stack_pop(read_work);
+
+        if (!frame.value) {
+            if (frame.abs) {
+                Expr* body = stack_pop(read_results);
+                stack_push(read_results, mk_abs(frame.abs->abs.param, body));
+            } else {
+                Expr* arg = stack_pop(read_results);
+                Expr* func = stack_pop(read_results);
+                stack_push(read_results, mk_app(func, arg));
+            }
+            continue;
+        }
+
+        Value* current = frame.value;
+        switch (current->kind) {
+            case VALUE_CLOSURE:
+            {
+                // normalise under the binder by applying to a fresh variable
+                Value* var = new_value(VALUE_LEVEL);
+                var->level = frame.depth;
+                Expr* abs = current->closure.abs;
+                MEnv* env = extend(new_thunk(NULL, NULL, var), current->closure.env);
+                Value* body = machine_eval(abs_body(abs), env, globals, strategy);
+                if (!body) {
+                    // a limit tripped while normalising under the binder
+                    read_work.count = base;
+                    read_results.count = results_base;
+                    return NULL;
+                }
+                stack_push(read_work, ((ReadFrame){ NULL, abs, frame.depth }));
+                stack_push(read_work, ((ReadFrame){ body, NULL, frame.depth + 1 }));
+                break;
+            }
+            case VALUE_LEVEL:
+                stack_push(read_results, mk_var(frame.depth - 1 - current->level));
+                break;
+            case VALUE_FREE:
+                stack_push(read_results, mk_free(current->name));
+                break;
+            case VALUE_APP:
+            {
+                Value* arg = force(current->app.arg, globals, strategy);
+                if (!arg) {
+                    read_work.count = base;
+                    read_results.count = results_base;
+                    return NULL;
+                }
+                stack_push(read_work, ((ReadFrame){ NULL, NULL, frame.depth }));
+                stack_push(read_work, ((ReadFrame){ arg, NULL, frame.depth }));
+                stack_push(read_work, ((ReadFrame){ current->app.func, NULL, frame.depth }));
+                break;
+            }
+        }
+    }
+
+    return stack_pop(read_results);
+}
+
+Expr* machine_normalise(Expr* expr, Env* globals, Strategy strategy)
+{
+    Value* value = machine_eval(expr, NULL, globals, strategy);
+    return machine_readback(value, 0, globals, strategy);
+}
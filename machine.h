@@ -0,0 +1,66 @@
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#include "parser.h"
+#include "interpreter.h"
+
+/*
+ * Environment based evaluator (a CEK machine).
+ *
+ * Instead of substituting into the body of a function, an abstraction
+ * evaluates to a closure that pairs it with the values of its free
+ * variables. Applying a closure pushes the argument onto that environment,
+ * so a beta step is O(1) pointer work. Values are only turned back into
+ * terms (read back) for printing, which is also where bodies under lambdas
+ * get normalised, by applying each closure to a fresh neutral variable.
+ *
+ * Under call-by-need an argument is not evaluated before the call. It is
+ * bound as a thunk, forced the first time the variable is used and then
+ * updated in place so every other use shares the result.
+ */
+
+typedef struct Value Value;
+typedef struct MEnv MEnv;
+
+typedef enum {
+    STRATEGY_CBV,   // arguments are evaluated before the call
+    STRATEGY_NEED,  // arguments are shared thunks, evaluated at most once
+} Strategy;
+
+// A delayed argument, `value` is set once it has been forced
+typedef struct {
+    Expr* term;
+    MEnv* env;
+    Value* value;
+} Thunk;
+
+// Linked environment, the De Bruijn index of a variable is its position
+struct MEnv {
+    Thunk* thunk;
+    MEnv* next;
+};
+
+typedef enum {
+    VALUE_CLOSURE,  // an abstraction with its environment
+    VALUE_LEVEL,    // variable standing for a binder during read back
+    VALUE_FREE,     // unresolved global
+    VALUE_APP,      // stuck application of a neutral value
+} ValueKind;
+
+struct Value {
+    ValueKind kind;
+    union {
+        struct { Expr* abs; MEnv* env; } closure;
+        int level;
+        Symbol name;
+        struct { Value* func; Thunk* arg; } app;
+    };
+};
+
+Value* machine_eval(Expr* expr, MEnv* env, Env* globals, Strategy strategy);
+Expr* machine_readback(Value* value, int depth, Env* globals, Strategy strategy);
+
+// Evaluate a closed top-level expression to its normal form
+Expr* machine_normalise(Expr* expr, Env* globals, Strategy strategy);
+
+#endif // MACHINE_H
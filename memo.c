@@ -0,0 +1,130 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "memo.h"
+
+#define MEMO_NONE UINT32_MAX
+
+typedef struct {
+    Expr* func;
+    Expr* arg;
+    Expr* value;
+    bool flag;
+    uint32_t chain;       // next entry in the same bucket
+    uint32_t newer;       // LRU list neighbours
+    uint32_t older;
+} MemoEntry;
+
+static MemoEntry* entries = NULL;
+static uint32_t* buckets = NULL;
+static size_t capacity = 0;
+static size_t bucket_count = 0;  // power of two, at least twice the capacity
+static size_t count = 0;
+static uint32_t newest = MEMO_NONE;
+static uint32_t oldest = MEMO_NONE;
+
+void set_memo_capacity(size_t entry_limit)
+{
+    free(entries);
+    free(buckets);
+    entries = NULL;
+    buckets = NULL;
+    capacity = entry_limit < MEMO_NONE ? entry_limit : MEMO_NONE - 1;
+    bucket_count = 0;
+    if (capacity == 0) return;
+
+    bucket_count = 16;
+    while (bucket_count < capacity * 2) bucket_count *= 2;
+    entries = malloc(capacity * sizeof(MemoEntry));
+    buckets = malloc(bucket_count * sizeof(uint32_t));
+    if (!entries || !buckets) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    memo_clear();
+}
+
+bool memo_enabled(void)
+{
+    return capacity > 0;
+}
+
+void memo_clear(void)
+{
+    for (size_t i = 0; i < bucket_count; i++) buckets[i] = MEMO_NONE;
+    count = 0;
+    newest = MEMO_NONE;
+    oldest = MEMO_NONE;
+}
+
+static size_t bucket_of(const Expr* func, const Expr* arg)
+{
+    return (func->hash * 31u + arg->hash) & (bucket_count - 1);
+}
+
+static void unlink_lru(uint32_t i)
+{
+    MemoEntry* e = &entries[i];
+    if (e->newer != MEMO_NONE) entries[e->newer].older = e->older;
+    else newest = e->older;
+    if (e->older != MEMO_NONE) entries[e->older].newer = e->newer;
+    else oldest = e->newer;
+}
+
+static void push_newest(uint32_t i)
+{
+    entries[i].older = newest;
+    entries[i].newer = MEMO_NONE;
+    if (newest != MEMO_NONE) entries[newest].newer = i;
+    newest = i;
+    if (oldest == MEMO_NONE) oldest = i;
+}
+
+Expr* memo_lookup(Expr* func, Expr* arg, bool* flag)
+{
+    if (capacity == 0) return NULL;
+
+    for (uint32_t i = buckets[bucket_of(func, arg)]; i != MEMO_NONE; i = entries[i].chain) {
+        if (entries[i].func == func && entries[i].arg == arg) {
+            if (i != newest) {
+                unlink_lru(i);
+                push_newest(i);
+            }
+            *flag = entries[i].flag;
+            return entries[i].value;
+        }
+    }
+    return NULL;
+}
+
+void memo_store(Expr* func, Expr* arg, Expr* value, bool flag)
+{
+    if (capacity == 0) return;
+
+    uint32_t i;
+    if (count < capacity) {
+        i = (uint32_t)count++;
+    } else {
+        // reuse the least recently used entry, taking it out of its bucket
+        i = oldest;
+        unlink_lru(i);
+        uint32_t* link = &buckets[bucket_of(entries[i].func, entries[i].arg)];
+        while (*link != i) link = &entries[*link].chain;
+        *link = entries[i].chain;
+    }
+
+    size_t b = bucket_of(func, arg);
+    entries[i] = (MemoEntry){ func, arg, value, flag, buckets[b], MEMO_NONE, MEMO_NONE };
+    buckets[b] = i;
+    push_newest(i);
+}
+
+void memo_relocate(Expr* (*move)(Expr* term, void* ctx), void* ctx)
+{
+    for (size_t i = 0; i < count; i++) {
+        entries[i].func = move(entries[i].func, ctx);
+        entries[i].arg = move(entries[i].arg, ctx);
+        entries[i].value = move(entries[i].value, ctx);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parser.h"
+
+/*
+ * Memo table for eval: the normal form of an application of an abstraction
+ * to an argument. Terms are hash-consed, so the pair of pointers is the key
+ * and a hit means the same function applied to the same argument. Nameless
+ * terms mean the same thing under any binders, so open terms are cached too.
+ *
+ * The table holds at most `capacity` entries and evicts the least recently
+ * used one. Entries point into the current expression's region, so it is
+ * cleared before every top-level expression.
+ */
+
+void set_memo_capacity(size_t capacity); // 0 turns memoization off
+bool memo_enabled(void);
+void memo_clear(void);
+
+// The cached normal form or NULL, `flag` returns what was stored with it
+Expr* memo_lookup(Expr* func, Expr* arg, bool* flag);
+void memo_store(Expr* func, Expr* arg, Expr* value, bool flag);
+
+// Replace every term in the table with move(term), which has to keep its
+// hash, when a collector moves them
+void memo_relocate(Expr* (*move)(Expr* term, void* ctx), void* ctx);
+
+#endif // MEMO_H
@@ -0,0 +1,155 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libgen.h>
+
+#include "module.h"
+
+// String keyed hash table, open addressing, keys and values owned
+typedef struct {
+    char** keys;
+    char** values;
+    size_t capacity;
+    size_t count;
+} StringTable;
+
+static StringTable resolved = {0};   // "importer dir\nname" -> canonical path
+static StringTable loaded = {0};     // canonical path -> itself
+
+static char** search_dirs = NULL;
+static size_t search_dir_count = 0;
+static bool search_ready = false;
+
+static uint64_t hash_string(const char* s)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (; *s; s++) h = (h ^ (unsigned char)*s) * 1099511628211ull;
+    return h;
+}
+
+static size_t table_slot(const StringTable* table, const char* key)
+{
+    size_t mask = table->capacity - 1;
+    size_t i = hash_string(key) & mask;
+    while (table->keys[i] && strcmp(table->keys[i], key) != 0) i = (i + 1) & mask;
+    return i;
+}
+
+static char* table_get(const StringTable* table, const char* key)
+{
+    if (table->capacity == 0) return NULL;
+    return table->values[table_slot(table, key)];
+}
+
+static char* table_put(StringTable* table, const char* key, const char* value)
+{
+    if ((table->count + 1) * 2 > table->capacity) {
+        StringTable grown = { .capacity = table->capacity ? table->capacity * 2 : 64 };
+        grown.keys = calloc(grown.capacity, sizeof(char*));
+        grown.values = calloc(grown.capacity, sizeof(char*));
+        if (!grown.keys || !grown.values) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        for (size_t i = 0; i < table->capacity; i++) {
+            if (!table->keys[i]) continue;
+            size_t slot = table_slot(&grown, table->keys[i]);
+            grown.keys[slot] = table->keys[i];
+            grown.values[slot] = table->values[i];
+        }
+        grown.count = table->count;
+        free(table->keys);
+        free(table->values);
+        *table = grown;
+    }
+
+    size_t slot = table_slot(table, key);
+    if (!table->keys[slot]) {
+        table->keys[slot] = strdup(key);
+        table->count++;
+    }
+    free(table->values[slot]);
+    table->values[slot] = strdup(value);
+    return table->values[slot];
+}
+
+static void read_search_path(void)
+{
+    search_ready = true;
+    const char* list = getenv("LAMB_PATH");
+    if (!list) list = LAMB_PATH_DEFAULT;
+
+    char* copy = strdup(list);
+    for (char* dir = strtok(copy, ":"); dir; dir = strtok(NULL, ":")) {
+        search_dirs = realloc(search_dirs, (search_dir_count + 1) * sizeof(char*));
+        if (!search_dirs) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        search_dirs[search_dir_count++] = strdup(dir);
+    }
+    free(copy);
+}
+
+// realpath doubles as the existence check, one syscall per candidate
+static char* try_path(const char* dir, const char* name)
+{
+    if (!dir || name[0] == '/') return realpath(name, NULL);
+
+    size_t len = strlen(dir) + strlen(name) + 2;
+    char* joined = malloc(len);
+    snprintf(joined, len, "%s/%s", dir, name);
+    char* canonical = realpath(joined, NULL);
+    free(joined);
+    return canonical;
+}
+
+static char* search(const char* importer_dir, const char* name)
+{
+    char* found = NULL;
+    if (importer_dir) found = try_path(importer_dir, name);
+    if (!found) found = try_path(NULL, name);
+    for (size_t i = 0; !found && i < search_dir_count; i++) found = try_path(search_dirs[i], name);
+    return found;
+}
+
+const char* resolve_module(const char* importer, const char* name)
+{
+    if (!name || !*name) return NULL;
+    if (!search_ready) read_search_path();
+
+    char* importer_copy = importer ? strdup(importer) : NULL;
+    const char* importer_dir = importer_copy ? dirname(importer_copy) : NULL;
+
+    size_t key_len = (importer_dir ? strlen(importer_dir) : 0) + strlen(name) + 2;
+    char* key = malloc(key_len);
+    snprintf(key, key_len, "%s\n%s", importer_dir ? importer_dir : "", name);
+
+    const char* canonical = table_get(&resolved, key);
+    if (!canonical) {
+        char* found = search(importer_dir, name);
+
+        size_t len = strlen(name);
+        if (!found && len > 5 && strcmp(name + len - 5, ".lamb") == 0) {
+            char* alt = malloc(len);
+            memcpy(alt, name, len - 5);
+            strcpy(alt + len - 5, ".l");
+            found = search(importer_dir, alt);
+            free(alt);
+        }
+        if (found) canonical = table_put(&resolved, key, found);
+        free(found);
+    }
+
+    free(key);
+    free(importer_copy);
+    return canonical;
+}
+
+bool module_first_load(const char* canonical)
+{
+    if (table_get(&loaded, canonical)) return false;
+    table_put(&loaded, canonical, canonical);
+    return true;
+}
@@ -0,0 +1,27 @@
+#ifndef MODULE_H
+#define MODULE_H
+
+#include <stdbool.h>
+
+/*
+ * Module registry.
+ *
+ * `#import "name"` is resolved, in order, relative to the importing file,
+ * relative to the working directory, then in every directory of LAMB_PATH
+ * (colon separated, `examples` when unset). A `.lamb` name falls back to
+ * `.l`. Resolutions are cached per importing directory, and every module is
+ * known by its canonical path so it is loaded at most once per process,
+ * however many files import it.
+ */
+
+#define LAMB_PATH_DEFAULT "examples"
+
+// Canonical path of module `name` imported from file `importer` (NULL at
+// the REPL), NULL if it does not exist. The string belongs to the registry.
+const char* resolve_module(const char* importer, const char* name);
+
+// True the first time it is asked about a canonical path, the caller then
+// loads the module. Marked before loading, so import cycles stop.
+bool module_first_load(const char* canonical);
+
+#endif // MODULE_H
@@ -0,0 +1,735 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "net.h"
+#include "budget.h"
+#include "stats.h"
+#include "diagnostics.h"
+#include "debug.h"
+#include "stack.h"
+
+typedef enum {
+    NODE_CON,   // lambda or application, told apart by the port read back through
+    NODE_DUP,   // shares one value between two users
+    NODE_ERA,   // drops a value
+    NODE_FREE,  // unresolved global
+    NODE_NAPP,  // application stuck on a free variable
+} NodeKind;
+
+// A port is what an aux slot is plugged into: the principal port of a node or
+// one end of a wire. Empty wires hold PORT_NONE.
+typedef uint64_t Port;
+
+#define PORT_NONE 0
+#define PORT_WIRE 1
+#define PORT_NODE 2
+
+#define port_tag(p) ((p) & 3)
+#define port_id(p) ((uint32_t)((p) >> 2))
+#define wire_port(id) (((Port)(id) << 2) | PORT_WIRE)
+#define node_port(id) (((Port)(id) << 2) | PORT_NODE)
+
+typedef struct {
+    uint8_t kind;
+    uint8_t dead;      // consumed by an interaction
+    uint32_t label;    // DUP label, CON binder hint, FREE name
+    Port aux[2];       // written once, before the node is reachable
+} Node;
+
+// Both ends of a wire sit in aux slots or in the hands of a link. The first
+// end linked leaves its partner in target, the second one takes it over. An
+// end that becomes the partner left in another wire records that wire in
+// joined, so read back can walk the connection from either side.
+typedef struct {
+    _Atomic Port target;
+    _Atomic Port joined[2];
+    uint32_t holder[2];
+    uint8_t slot[2];
+} Wire;
+
+#define NO_HOLDER UINT32_MAX
+
+// Nodes and wires are claimed a chunk at a time by each worker. Past
+// NET_CHUNK_LIMIT chunks the reduction gives up, a term whose duplications
+// clash can grow without end.
+#define NET_CHUNK_BITS 16
+#define NET_CHUNK_SIZE (1u << NET_CHUNK_BITS)
+#define NET_MAX_CHUNKS (1u << 16)
+#define NET_CHUNK_LIMIT 128
+
+static Node* node_chunks[NET_MAX_CHUNKS];
+static Wire* wire_chunks[NET_MAX_CHUNKS];
+static atomic_uint node_chunk_count;
+static atomic_uint wire_chunk_count;
+
+#define node_at(id) (&node_chunks[(id) >> NET_CHUNK_BITS][(id) & (NET_CHUNK_SIZE - 1)])
+#define wire_at(id) (&wire_chunks[(id) >> NET_CHUNK_BITS][(id) & (NET_CHUNK_SIZE - 1)])
+
+typedef struct { Port a; Port b; } Redex;
+
+// Redexes handed to other workers, never reused while the net runs so the
+// stack cannot see the same cell twice
+typedef struct SharedRedex {
+    Redex redex;
+    struct SharedRedex* next;
+} SharedRedex;
+
+static _Atomic(SharedRedex*) shared_redexes;
+static atomic_size_t pending;       // redexes created but not yet rewritten
+static atomic_int idle_workers;
+static atomic_bool overflow;
+static bool serial;                 // one worker, steps go straight to log_reduction
+
+typedef struct {
+    uint32_t node_next, node_end;
+    uint32_t wire_next, wire_end;
+    struct { Redex* items; size_t count; size_t capacity; } redexes;
+    Arena cells;
+    unsigned long beta;   // added to stats once the workers join
+    size_t max_depth;
+} Worker;
+
+static uint32_t claim_chunk(atomic_uint* count, void** chunks, size_t size)
+{
+    uint32_t chunk = atomic_fetch_add(count, 1);
+    if (chunk >= NET_CHUNK_LIMIT) atomic_store(&overflow, true);
+    if (chunk >= NET_MAX_CHUNKS) {
+        report_interp(DIAG_ERROR, "Interaction net is too large");
+        exit(1);
+    }
+    chunks[chunk] = calloc(NET_CHUNK_SIZE, size);
+    budget_charge(NET_CHUNK_SIZE * size);
+    if (!chunks[chunk]) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    return chunk << NET_CHUNK_BITS;
+}
+
+static uint32_t new_node(Worker* w, NodeKind kind, uint32_t label)
+{
+    if (w->node_next == w->node_end) {
+        w->node_next = claim_chunk(&node_chunk_count, (void**)node_chunks, sizeof(Node));
+        w->node_end = w->node_next + NET_CHUNK_SIZE;
+    }
+    uint32_t id = w->node_next++;
+    Node* node = node_at(id);
+    node->kind = kind;
+    node->label = label;
+    return id;
+}
+
+static uint32_t new_wire(Worker* w)
+{
+    if (w->wire_next == w->wire_end) {
+        w->wire_next = claim_chunk(&wire_chunk_count, (void**)wire_chunks, sizeof(Wire));
+        w->wire_end = w->wire_next + NET_CHUNK_SIZE;
+    }
+    uint32_t id = w->wire_next++;
+    Wire* wire = wire_at(id);
+    wire->holder[0] = wire->holder[1] = NO_HOLDER;
+    return id;
+}
+
+// Plug a port into an aux slot of a node that is not reachable yet
+static void place(uint32_t id, int slot, Port port)
+{
+    node_at(id)->aux[slot] = port;
+    if (port_tag(port) == PORT_WIRE) {
+        Wire* wire = wire_at(port_id(port));
+        int side = wire->holder[0] == NO_HOLDER ? 0 : 1;
+        wire->holder[side] = id;
+        wire->slot[side] = slot;
+    }
+}
+
+static void push_redex(Worker* w, Port a, Port b)
+{
+    atomic_fetch_add(&pending, 1);
+    if (w->redexes.count > 0 && atomic_load_explicit(&idle_workers, memory_order_relaxed) > 0) {
+        SharedRedex* cell = arena_alloc(&w->cells, sizeof(SharedRedex));
+        cell->redex = (Redex){ a, b };
+        cell->next = atomic_load(&shared_redexes);
+        while (!atomic_compare_exchange_weak(&shared_redexes, &cell->next, cell));
+        return;
+    }
+    stack_push(w->redexes, ((Redex){ a, b }));
+}
+
+static bool pop_shared(Redex* out)
+{
+    SharedRedex* cell = atomic_load(&shared_redexes);
+    while (cell && !atomic_compare_exchange_weak(&shared_redexes, &cell, cell->next));
+    if (!cell) return false;
+    *out = cell->redex;
+    return true;
+}
+
+// Connect two ports; two principal ports make a new active pair
+static void link(Worker* w, Port a, Port b)
+{
+    for (;;) {
+        if (port_tag(a) != PORT_WIRE) {
+            Port t = a;
+            a = b;
+            b = t;
+        }
+        if (port_tag(a) != PORT_WIRE) {
+            push_redex(w, a, b);
+            return;
+        }
+        Port got = atomic_exchange(&wire_at(port_id(a))->target, b);
+        if (got == PORT_NONE) {
+            if (port_tag(b) == PORT_WIRE) {
+                Port none = PORT_NONE;
+                Wire* end = wire_at(port_id(b));
+                if (!atomic_compare_exchange_strong(&end->joined[0], &none, a)) end->joined[1] = a;
+            }
+            return;
+        }
+        // the other end got there first, join what both ends were linked to
+        a = got;
+    }
+}
+
+static void annihilate(Worker* w, Node* a, Node* b)
+{
+    link(w, a->aux[0], b->aux[0]);
+    link(w, a->aux[1], b->aux[1]);
+}
+
+static void commute(Worker* w, Node* a, Node* b)
+{
+    uint32_t p = new_node(w, b->kind, b->label);
+    uint32_t q = new_node(w, b->kind, b->label);
+    uint32_t r = new_node(w, a->kind, a->label);
+    uint32_t s = new_node(w, a->kind, a->label);
+    uint32_t x = new_wire(w), y = new_wire(w), z = new_wire(w), v = new_wire(w);
+    place(p, 0, wire_port(x));
+    place(p, 1, wire_port(y));
+    place(q, 0, wire_port(z));
+    place(q, 1, wire_port(v));
+    place(r, 0, wire_port(x));
+    place(r, 1, wire_port(z));
+    place(s, 0, wire_port(y));
+    place(s, 1, wire_port(v));
+    link(w, a->aux[0], node_port(p));
+    link(w, a->aux[1], node_port(q));
+    link(w, b->aux[0], node_port(r));
+    link(w, b->aux[1], node_port(s));
+}
+
+static void erase(Worker* w, Node* node)
+{
+    link(w, node_port(new_node(w, NODE_ERA, 0)), node->aux[0]);
+    link(w, node_port(new_node(w, NODE_ERA, 0)), node->aux[1]);
+}
+
+// An application meeting a neutral term stays stuck, the neutral one lives on
+static void stuck_apply(Worker* w, uint32_t neutral, Node* app)
+{
+    uint32_t result = new_node(w, NODE_NAPP, 0);
+    uint32_t arg = new_wire(w);
+    place(result, 0, node_port(neutral));
+    place(result, 1, wire_port(arg));
+    link(w, wire_port(arg), app->aux[0]);
+    link(w, node_port(result), app->aux[1]);
+}
+
+static void interact(Worker* w, Port pa, Port pb)
+{
+    uint32_t ia = port_id(pa), ib = port_id(pb);
+    Node* a = node_at(ia);
+    Node* b = node_at(ib);
+    if (a->kind > b->kind) {
+        Node* t = a; a = b; b = t;
+        uint32_t i = ia; ia = ib; ib = i;
+    }
+    a->dead = b->dead = 1;
+
+    switch (a->kind * 8 + b->kind) {
+        case NODE_CON * 8 + NODE_CON:
+            // a lambda meeting an application, there is no term to show
+            if (serial) log_reduction(REDUCTION_BETA, "annihilating", NULL);
+            else w->beta++;
+            annihilate(w, a, b);
+            break;
+        case NODE_DUP * 8 + NODE_DUP:
+            if (a->label == b->label) annihilate(w, a, b);
+            else commute(w, a, b);
+            break;
+        case NODE_CON * 8 + NODE_DUP:
+        case NODE_DUP * 8 + NODE_NAPP:
+            commute(w, a, b);
+            break;
+        case NODE_CON * 8 + NODE_ERA:
+        case NODE_DUP * 8 + NODE_ERA:
+            erase(w, a);
+            break;
+        case NODE_ERA * 8 + NODE_NAPP:
+            erase(w, b);
+            break;
+        case NODE_CON * 8 + NODE_FREE:
+        case NODE_CON * 8 + NODE_NAPP:
+            b->dead = 0;
+            stuck_apply(w, ib, a);
+            break;
+        case NODE_DUP * 8 + NODE_FREE:
+            link(w, node_port(new_node(w, NODE_FREE, b->label)), a->aux[0]);
+            link(w, node_port(new_node(w, NODE_FREE, b->label)), a->aux[1]);
+            break;
+        default:
+            // erasers meeting leaves, nothing left to do
+            break;
+    }
+}
+
+static void reduce(Worker* w)
+{
+    Redex redex;
+    while (!atomic_load_explicit(&overflow, memory_order_relaxed)) {
+        if (w->redexes.count > 0) {
+            redex = stack_pop(w->redexes);
+        } else if (!pop_shared(&redex)) {
+            if (atomic_load(&pending) == 0) return;
+            atomic_fetch_add(&idle_workers, 1);
+            while (!atomic_load(&shared_redexes) && atomic_load(&pending) > 0 && !atomic_load(&overflow)) {
+                sched_yield();
+            }
+            atomic_fetch_sub(&idle_workers, 1);
+            continue;
+        }
+        if (w->redexes.count + 1 > w->max_depth) w->max_depth = w->redexes.count + 1;
+        interact(w, redex.a, redex.b);
+        atomic_fetch_sub(&pending, 1);
+        if (!budget_spend()) atomic_store(&overflow, true);
+    }
+}
+
+static void* worker_main(void* arg)
+{
+    reduce(arg);
+    return NULL;
+}
+
+/* Translation */
+
+typedef enum {
+    BUILD_ENTER,
+    BUILD_ABS,
+    BUILD_APP,
+    BUILD_GLOBAL,  // leave the body of an inlined global
+} BuildKind;
+
+typedef struct {
+    BuildKind kind;
+    Expr* expr;
+} BuildFrame;
+
+typedef struct { uint32_t* items; size_t count; size_t capacity; } Uses;
+
+static struct { BuildFrame* items; size_t count; size_t capacity; } build_stack = {0};
+static struct { Port* items; size_t count; size_t capacity; } ports = {0};
+static struct { Uses* items; size_t count; size_t capacity; } binders = {0};
+static struct { Symbol* items; size_t count; size_t capacity; } expanding = {0};
+
+// Hand every use of a variable its own copy through a chain of DUP nodes
+static void share(Worker* w, uint32_t id, int slot, Uses uses, uint32_t* labels)
+{
+    if (uses.count == 0) {
+        place(id, slot, node_port(new_node(w, NODE_ERA, 0)));
+        return;
+    }
+    for (size_t i = 0; i + 1 < uses.count; i++) {
+        uint32_t dup = new_node(w, NODE_DUP, (*labels)++);
+        place(id, slot, node_port(dup));
+        place(dup, 0, wire_port(uses.items[i]));
+        id = dup;
+        slot = 1;
+    }
+    place(id, slot, wire_port(uses.items[uses.count - 1]));
+}
+
+// Build the net of expr with globals inlined, returns the port carrying its
+// value or PORT_NONE if a global refers to itself
+static Port build(Worker* w, Expr* expr, Env* globals)
+{
+    uint32_t labels = 1;
+    stack_push(build_stack, ((BuildFrame){ BUILD_ENTER, expr }));
+
+    while (build_stack.count > 0) {
+        BuildFrame frame = stack_pop(build_stack);
+        Expr* e = frame.expr;
+
+        switch (frame.kind) {
+            case BUILD_ENTER:
+                switch (e->type) {
+                    case EXPR_VAR:
+                        if (e->var.index >= 0) {
+                            uint32_t use = new_wire(w);
+                            stack_push(binders.items[binders.count - 1 - e->var.index], use);
+                            stack_push(ports, wire_port(use));
+                            break;
+                        }
+                        Expr* def = env_lookup(globals, e->var.name);
+                        if (!def) {
+                            stack_push(ports, node_port(new_node(w, NODE_FREE, e->var.name)));
+                            break;
+                        }
+                        for (size_t i = 0; i < expanding.count; i++) {
+                            if (expanding.items[i] != e->var.name) continue;
+                            // a recursive global cannot be inlined, leave it to another evaluator
+                            for (size_t j = 0; j < binders.count; j++) free(binders.items[j].items);
+                            build_stack.count = ports.count = binders.count = expanding.count = 0;
+                            return PORT_NONE;
+                        }
+                        log_reduction(REDUCTION_DELTA, "inlining", def);
+                        stack_push(expanding, e->var.name);
+                        stack_push(build_stack, ((BuildFrame){ BUILD_GLOBAL, e }));
+                        stack_push(build_stack, ((BuildFrame){ BUILD_ENTER, def }));
+                        break;
+                    case EXPR_ABS:
+                        stack_push(binders, ((Uses){0}));
+                        stack_push(build_stack, ((BuildFrame){ BUILD_ABS, e }));
+                        stack_push(build_stack, ((BuildFrame){ BUILD_ENTER, abs_body(e) }));
+                        break;
+                    case EXPR_APP:
+                        stack_push(build_stack, ((BuildFrame){ BUILD_APP, e }));
+                        stack_push(build_stack, ((BuildFrame){ BUILD_ENTER, app_arg(e) }));
+                        stack_push(build_stack, ((BuildFrame){ BUILD_ENTER, app_func(e) }));
+                        break;
+                    default:
+                        report_interp(DIAG_ERROR, "Unknown expression type");
+                        exit(1);
+                }
+                break;
+            case BUILD_ABS:
+            {
+                Uses uses = stack_pop(binders);
+                uint32_t lam = new_node(w, NODE_CON, e->abs.param);
+                share(w, lam, 0, uses, &labels);
+                place(lam, 1, stack_pop(ports));
+                free(uses.items);
+                stack_push(ports, node_port(lam));
+                break;
+            }
+            case BUILD_APP:
+            {
+                Port arg = stack_pop(ports);
+                Port func = stack_pop(ports);
+                uint32_t app = new_node(w, NODE_CON, SYMBOL_NONE);
+                uint32_t result = new_wire(w);
+                place(app, 0, arg);
+                place(app, 1, wire_port(result));
+                link(w, node_port(app), func);
+                stack_push(ports, wire_port(result));
+                break;
+            }
+            case BUILD_GLOBAL:
+                expanding.count--;
+                break;
+        }
+    }
+
+    return stack_pop(ports);
+}
+
+/* Read back */
+
+// Endpoints name a port of a live node, slot 0 being the principal one
+typedef uint64_t Endpoint;
+
+#define NO_ENDPOINT UINT64_MAX
+#define endpoint(id, slot) (((Endpoint)(id) << 2) | (slot))
+#define endpoint_node(e) ((uint32_t)((e) >> 2))
+#define endpoint_slot(e) ((int)((e) & 3))
+
+// Where a port plugged into `from` leads once the net is quiescent
+static Endpoint resolve(Port port, Endpoint from)
+{
+    Port prev = PORT_NONE;
+    bool joined = false;
+    for (;;) {
+        if (port_tag(port) == PORT_NODE) return endpoint(port_id(port), 0);
+        if (port_tag(port) != PORT_WIRE) return NO_ENDPOINT;
+
+        Wire* wire = wire_at(port_id(port));
+        Port target = atomic_load(&wire->target);
+        // arriving through joined, target is the end we came from
+        if (target != PORT_NONE && !joined) {
+            prev = port;
+            port = target;
+            from = NO_ENDPOINT;
+            continue;
+        }
+        for (int side = 0; side < 2; side++) {
+            uint32_t holder = wire->holder[side];
+            if (holder == NO_HOLDER || node_at(holder)->dead) continue;
+            Endpoint end = endpoint(holder, wire->slot[side] + 1);
+            if (end != from) return end;
+        }
+        // the other end was left in another wire, unless that wire's other
+        // end has since passed it on
+        Port next = PORT_NONE;
+        for (int side = 0; side < 2; side++) {
+            Port other = atomic_load(&wire->joined[side]);
+            if (other == PORT_NONE || other == prev) continue;
+            if (atomic_load(&wire_at(port_id(other))->target) == port) next = other;
+        }
+        if (next == PORT_NONE) return NO_ENDPOINT;
+        prev = port;
+        port = next;
+        from = NO_ENDPOINT;
+        joined = true;
+    }
+}
+
+// Choices taken at DUP nodes on the way to the current port
+typedef struct Path {
+    uint32_t label;
+    int slot;
+    const struct Path* next;
+} Path;
+
+typedef enum {
+    READ_PORT,
+    READ_ABS,
+    READ_APP,
+} ReadKind;
+
+typedef struct {
+    ReadKind kind;
+    Endpoint at;
+    int depth;
+    const Path* path;
+    size_t turns;       // length of path
+    Symbol hint;
+} ReadFrame;
+
+static struct { ReadFrame* items; size_t count; size_t capacity; } read_stack = {0};
+static struct { Expr** items; size_t count; size_t capacity; } results = {0};
+
+static Endpoint* principal_partner;
+static int* binder_depth;
+
+static Endpoint partner(Endpoint at)
+{
+    uint32_t id = endpoint_node(at);
+    int slot = endpoint_slot(at);
+    if (slot == 0) return principal_partner[id];
+    return resolve(node_at(id)->aux[slot - 1], at);
+}
+
+static struct { const Path** items; size_t count; size_t capacity; } path_prefix = {0};
+
+// Drop the latest choice made for label, copying the younger part of the path
+static const Path* take_choice(const Path* path, uint32_t label, int* slot)
+{
+    const Path* found = path;
+    path_prefix.count = 0;
+    while (found && found->label != label) {
+        stack_push(path_prefix, found);
+        found = found->next;
+    }
+    if (!found) return path;
+
+    *slot = found->slot;
+    const Path* rest = found->next;
+    while (path_prefix.count > 0) {
+        Path* copy = arena_alloc(&get_expr_region()->arena, sizeof(Path));
+        *copy = *stack_pop(path_prefix);
+        copy->next = rest;
+        rest = copy;
+    }
+    return rest;
+}
+
+static Expr* read_back(Port root, size_t node_count)
+{
+    principal_partner = malloc(node_count * sizeof(Endpoint));
+    binder_depth = malloc(node_count * sizeof(int));
+    if (!principal_partner || !binder_depth) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < node_count; i++) {
+        principal_partner[i] = NO_ENDPOINT;
+        binder_depth[i] = -1;
+    }
+    size_t dups = 0;
+    for (uint32_t id = 0; id < node_count; id++) {
+        Node* node = node_at(id);
+        if (node->dead) continue;
+        if (node->kind == NODE_DUP) dups++;
+        for (int slot = 1; slot <= 2; slot++) {
+            Endpoint end = resolve(node->aux[slot - 1], endpoint(id, slot));
+            if (end != NO_ENDPOINT && endpoint_slot(end) == 0) {
+                principal_partner[endpoint_node(end)] = endpoint(id, slot);
+            }
+        }
+    }
+
+    size_t base = results.count;
+    bool ok = true;
+    Endpoint start = resolve(root, NO_ENDPOINT);
+    if (start == NO_ENDPOINT) ok = false;
+    else stack_push(read_stack, ((ReadFrame){ .kind = READ_PORT, .at = start }));
+
+    while (ok && read_stack.count > 0) {
+        ReadFrame frame = stack_pop(read_stack);
+        switch (frame.kind) {
+            case READ_ABS:
+                stack_top(results) = mk_abs(frame.hint, stack_top(results));
+                continue;
+            case READ_APP:
+            {
+                Expr* arg = stack_pop(results);
+                stack_top(results) = mk_app(stack_top(results), arg);
+                continue;
+            }
+            case READ_PORT:
+                break;
+        }
+
+        if (frame.at == NO_ENDPOINT) {
+            ok = false;
+            break;
+        }
+        uint32_t id = endpoint_node(frame.at);
+        int slot = endpoint_slot(frame.at);
+        Node* node = node_at(id);
+        ReadFrame next = frame;
+
+        switch (node->kind * 4 + slot) {
+            case NODE_CON * 4 + 0:
+                // entered from the outside: a lambda
+                binder_depth[id] = frame.depth;
+                stack_push(read_stack, ((ReadFrame){ .kind = READ_ABS, .hint = node->label }));
+                next.at = partner(endpoint(id, 2));
+                next.depth = frame.depth + 1;
+                stack_push(read_stack, next);
+                break;
+            case NODE_CON * 4 + 1:
+                // entered through the variable port of a lambda
+                if (binder_depth[id] < 0 || binder_depth[id] >= frame.depth) {
+                    ok = false;
+                    break;
+                }
+                stack_push(results, mk_var(frame.depth - 1 - binder_depth[id]));
+                break;
+            case NODE_CON * 4 + 2:
+                // entered through the result port: an application
+                stack_push(read_stack, ((ReadFrame){ .kind = READ_APP }));
+                next.at = partner(endpoint(id, 1));
+                stack_push(read_stack, next);
+                next.at = partner(endpoint(id, 0));
+                stack_push(read_stack, next);
+                break;
+            case NODE_DUP * 4 + 1:
+            case NODE_DUP * 4 + 2:
+            {
+                // a path through more DUPs than the net holds is going round in circles
+                if (frame.turns > dups) {
+                    ok = false;
+                    break;
+                }
+                Path* step = arena_alloc(&get_expr_region()->arena, sizeof(Path));
+                *step = (Path){ node->label, slot, frame.path };
+                next.path = step;
+                next.turns = frame.turns + 1;
+                next.at = partner(endpoint(id, 0));
+                stack_push(read_stack, next);
+                break;
+            }
+            case NODE_DUP * 4 + 0:
+            {
+                int choice = -1;
+                next.path = take_choice(frame.path, node->label, &choice);
+                if (choice < 0) {
+                    ok = false;
+                    break;
+                }
+                next.turns = frame.turns - 1;
+                next.at = partner(endpoint(id, choice));
+                stack_push(read_stack, next);
+                break;
+            }
+            case NODE_FREE * 4 + 0:
+                stack_push(results, mk_free(node->label));
+                break;
+            case NODE_NAPP * 4 + 0:
+                stack_push(read_stack, ((ReadFrame){ .kind = READ_APP }));
+                next.at = partner(endpoint(id, 2));
+                stack_push(read_stack, next);
+                next.at = partner(endpoint(id, 1));
+                stack_push(read_stack, next);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+    }
+
+    free(principal_partner);
+    free(binder_depth);
+    read_stack.count = 0;
+    Expr* result = ok ? results.items[base] : NULL;
+    results.count = base;
+    return result;
+}
+
+static void free_net(void)
+{
+    for (uint32_t i = 0; i < node_chunk_count; i++) free(node_chunks[i]);
+    for (uint32_t i = 0; i < wire_chunk_count; i++) free(wire_chunks[i]);
+    node_chunk_count = 0;
+    wire_chunk_count = 0;
+    shared_redexes = NULL;
+    pending = 0;
+    idle_workers = 0;
+    overflow = false;
+}
+
+Expr* net_normalise(Expr* expr, Env* globals, int threads)
+{
+    if (threads < 1) threads = 1;
+    Worker* workers = calloc(threads, sizeof(Worker));
+    pthread_t* ids = calloc(threads, sizeof(pthread_t));
+    if (!workers || !ids) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    Port root = build(&workers[0], expr, globals);
+    if (root == PORT_NONE) {
+        workers[0].redexes.count = 0;
+        threads = 1;
+    }
+
+    serial = threads == 1;
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&ids[i], NULL, worker_main, &workers[i]) != 0) break;
+        started = i;
+    }
+    reduce(&workers[0]);
+    for (int i = 1; i <= started; i++) pthread_join(ids[i], NULL);
+
+    bool complete = root != PORT_NONE && !overflow;
+    Expr* result = !complete ? NULL : read_back(root, (size_t)node_chunk_count << NET_CHUNK_BITS);
+
+    for (int i = 0; i < threads; i++) {
+        stats.beta += workers[i].beta;
+        stats_depth(workers[i].max_depth);
+        free(workers[i].redexes.items);
+        arena_free(&workers[i].cells);
+    }
+    free(workers);
+    free(ids);
+    free_net();
+    return result;
+}
@@ -0,0 +1,25 @@
+#ifndef NET_H
+#define NET_H
+
+#include "interpreter.h"
+
+/*
+ * Interaction net backend.
+ *
+ * A term is translated into symmetric interaction combinators: lambdas and
+ * applications become CON nodes, a variable used more than once is shared
+ * through a tree of labelled DUP nodes and an unused one is plugged with an
+ * ERA node. Every rewrite only touches the two nodes of an active pair, so
+ * a pool of worker threads reduces pairs independently. Wires are joined
+ * with an atomic exchange instead of a lock. Once no active pair is left the
+ * net is read back into an Expr.
+ *
+ * Duplication uses one label per DUP node, without the bookkeeping of full
+ * optimal reduction. A term that makes a DUP copy a term containing the same
+ * DUP can read back inconsistently. In that case net_normalise returns NULL
+ * and the caller falls back to another evaluator.
+ */
+
+Expr* net_normalise(Expr* expr, Env* globals, int threads);
+
+#endif // NET_H
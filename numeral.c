@@ -0,0 +1,118 @@
+#include <limits.h>
+
+#include "numeral.h"
+
+// Normal forms of the combinators in De Bruijn prefix notation:
+// L is a lambda, A an application (function first), a digit a bound variable
+#define SUCC_SHAPE "LLLA1AA210"
+
+static const struct {
+    ArithOp op;
+    const char* shape;
+} shapes[] = {
+    { ARITH_SUCC, SUCC_SHAPE },
+    { ARITH_PRED, "LLLAAA2LLA0A13L1L0" },
+    { ARITH_PLUS, "LLAA1" SUCC_SHAPE "0" },
+    { ARITH_PLUS, "LLLLAA31AA210" },
+    { ARITH_MUL,  "LLLLAA3A210" },
+    { ARITH_MUL,  "LLLA2A10" },
+};
+
+#define MAX_SHAPE 32
+
+static bool has_shape(const Expr* expr, const char* shape)
+{
+    const Expr* pending[MAX_SHAPE];
+    int count = 0;
+    pending[count++] = expr;
+
+    for (const char* c = shape; *c; c++) {
+        if (count == 0) return false;
+        const Expr* e = pending[--count];
+        switch (*c) {
+            case 'L':
+                if (e->type != EXPR_ABS) return false;
+                pending[count++] = abs_body(e);
+                break;
+            case 'A':
+                if (e->type != EXPR_APP) return false;
+                pending[count++] = app_arg(e);
+                pending[count++] = app_func(e);
+                break;
+            default:
+                if (e->type != EXPR_VAR || e->var.index != *c - '0') return false;
+                break;
+        }
+    }
+    return count == 0;
+}
+
+bool numeral_value(const Expr* expr, unsigned long* n)
+{
+    if (expr->type == EXPR_NUM) {
+        *n = expr->num.value;
+        return true;
+    }
+    if (expr->type != EXPR_ABS || abs_body(expr)->type != EXPR_ABS) return false;
+
+    unsigned long count = 0;
+    const Expr* e = abs_body(abs_body(expr));
+    while (e->type == EXPR_APP && app_func(e)->type == EXPR_VAR && app_func(e)->var.index == 1) {
+        count++;
+        e = app_arg(e);
+    }
+    if (count == 0 || e->type != EXPR_VAR || e->var.index != 0) return false;
+    *n = count;
+    return true;
+}
+
+Expr* as_numeral(Expr* expr)
+{
+    unsigned long n;
+    if (expr->type != EXPR_ABS || !numeral_value(expr, &n)) return expr;
+    return mk_num(n, expr->abs.param, abs_body(expr)->abs.param);
+}
+
+Expr* numeral_term(const Expr* num)
+{
+    Expr* body = mk_var(0);
+    for (unsigned long i = 0; i < num->num.value; i++) body = mk_app(mk_var(1), body);
+    return mk_abs(num->num.succ, mk_abs(num->num.zero, body));
+}
+
+ArithOp arith_op(const Expr* func)
+{
+    if (func->type != EXPR_ABS) return ARITH_NONE;
+    for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+        if (has_shape(func, shapes[i].shape)) return shapes[i].op;
+    }
+    return ARITH_NONE;
+}
+
+int arith_arity(ArithOp op)
+{
+    return op == ARITH_PLUS || op == ARITH_MUL ? 2 : 1;
+}
+
+bool arith_apply(ArithOp op, unsigned long a, unsigned long b, unsigned long* result)
+{
+    switch (op) {
+        case ARITH_SUCC:
+            if (a == ULONG_MAX) return false;
+            *result = a + 1;
+            return true;
+        case ARITH_PRED:
+            *result = a == 0 ? 0 : a - 1;
+            return true;
+        case ARITH_PLUS:
+            if (a > ULONG_MAX - b) return false;
+            *result = a + b;
+            return true;
+        case ARITH_MUL:
+            if (a != 0 && b > ULONG_MAX / a) return false;
+            *result = a * b;
+            return true;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef NUMERAL_H
+#define NUMERAL_H
+
+#include "parser.h"
+
+/*
+ * Church numerals as machine integers.
+ *
+ * eval turns a numeral it has normalised into an EXPR_NUM node and runs
+ * the stdLamb arithmetic combinators on such nodes directly, so S, PRED,
+ * PLUS and MUL cost one step instead of one per unit of the value. A NUM
+ * only goes back to λs.λz. s (... (s z)) when it is applied to something.
+ * Combinators are recognised by the shape of their normal form, whatever
+ * names they were defined under.
+ */
+
+typedef enum {
+    ARITH_NONE,
+    ARITH_SUCC,  // λn f x. f (n f x)
+    ARITH_PRED,  // λn f x. n (λg h. h (g f)) (λu. x) (λu. u)
+    ARITH_PLUS,  // λm n. m SUCC n, or λm n f x. m f (n f x)
+    ARITH_MUL,   // λm n f x. m (n f) x, or λm n f. m (n f)
+} ArithOp;
+
+// A NUM, or λs.λz. s (... (s z)) with at least one s. Zero is left alone
+// as it is also F.
+bool numeral_value(const Expr* expr, unsigned long* n);
+Expr* as_numeral(Expr* expr);  // the NUM for a numeral lambda, else expr
+Expr* numeral_term(const Expr* num);
+
+ArithOp arith_op(const Expr* func);
+int arith_arity(ArithOp op);
+// false when the result does not fit, the caller then reduces by hand
+bool arith_apply(ArithOp op, unsigned long a, unsigned long b, unsigned long* result);
+
+#endif // NUMERAL_H
@@ -5,6 +5,37 @@
 #include "diagnostics.h"
 #include "parser.h"
 #include "debug.h"
+#include "stack.h"
+
+// Binders in scope while lowering to De Bruijn form, innermost last
+static Symbol* scope = NULL;
+static int scope_count = 0;
+static int scope_capacity = 0;
+
+static void scope_push(Symbol name)
+{
+  if (scope_count >= scope_capacity)
+  {
+    scope_capacity = scope_capacity == 0 ? 16 : scope_capacity * 2;
+    scope = realloc(scope, scope_capacity * sizeof(*scope));
+    if (!scope)
+    {
+      fprintf(stderr, "Memory allocation failed\n");
+      exit(1);
+    }
+  }
+  scope[scope_count++] = name;
+}
+
+// Returns the De Bruijn index of `name`, or -1 if it is free
+static int scope_index(Symbol name)
+{
+  for (int i = scope_count - 1; i >= 0; i--)
+  {
+    if (scope[i] == name) return scope_count - 1 - i;
+  }
+  return -1;
+}
 
 void expect_and_consume(Token token, TokenType expect, int* pos)
 {
@@ -48,29 +79,22 @@ Expr* parse_variable(TokenStream tokens, int* pos)
     Token tok = tokens.tokens[*pos];
     
     expect_and_consume(tok, TOKEN_IDENT, pos);
-    Expr* e = malloc(sizeof(Expr));
-    e->type = EXPR_VAR;
-    e->var.name = strdup(tok.value);
-    return e;
+    Symbol name = token_symbol(tok);
+    int index = scope_index(name);
+    return index < 0 ? mk_free(name) : mk_var(index);
 }
 
-Expr* parse_function(TokenStream tokenStream, int* pos)
+// Consumes `(\x y .` and brings the parameters into scope, returns their count
+static int parse_lambda_head(Token* tokens, int* pos)
 {
-  Token* tokens = tokenStream.tokens;
-
   expect_and_consume(tokens[*pos], TOKEN_LPAREN, pos);
   expect_and_consume(tokens[*pos], TOKEN_LAMBDA, pos);
   
-  char* params[64]; // Arbirary Limit of 64 parameters TODO: dynamic array
   int param_count = 0;
-
   while (tokens[*pos].type == TOKEN_IDENT)
   {
-    if (param_count >= 64)
-    {
-      report_diag(DIAG_ERROR, *pos, "Too many parameters in Lambda abstraction.");
-    }
-    params[param_count++] = strdup(tokens[*pos].value);
+    scope_push(token_symbol(tokens[*pos]));
+    param_count++;
     (*pos)++;
   }
 
@@ -80,64 +104,100 @@ Expr* parse_function(TokenStream tokenStream, int* pos)
   }
 
   expect_and_consume(tokens[*pos], TOKEN_DOT, pos); 
+  return param_count;
+}
 
-  Expr* body = parse_expression(tokenStream, pos);
-  if (!body) 
-  {
-    report_diag(DIAG_ERROR, *pos, "Invalid Syntax: Empty Function Body not allowed.");
-  }
-
-  expect_and_consume(tokens[*pos], TOKEN_RPAREN, pos);
-
-  for (int i = param_count - 1; i >= 0; i--)
-  {
-    Expr* abs = malloc(sizeof(Expr)); // free this
-    abs->type = EXPR_ABS;
-    abs->abs.param = params[i];
-    abs->abs.body = body;
-    body = abs;
-  }
+// An open `(` or `(\x .` whose application is still being accumulated
+typedef enum
+{
+  GROUP_TOP,
+  GROUP_PAREN,
+  GROUP_LAMBDA
+} GroupKind;
 
-  return body;
-}
+typedef struct
+{
+  GroupKind kind;
+  Expr* acc;       // left associative application parsed so far
+  int param_count; // parameters bound by a lambda group
+} Group;
 
+static struct { Group* items; size_t count; size_t capacity; } groups = {0};
 
-Expr* parse_primary(TokenStream tokenStream, int* pos)
+// Parses a sequence of primaries into a left associative application.
+// Nesting is kept on an explicit stack of open groups instead of recursing,
+// so the depth of the input is bounded by memory only.
+static Expr* parse_application(TokenStream tokenStream, int* pos)
 {
-  Token tok = tokenStream.tokens[*pos];
   Token* tokens = tokenStream.tokens;
+  size_t base = groups.count;
+  stack_push(groups, ((Group){ GROUP_TOP, NULL, 0 }));
 
-  if (tok.type == TOKEN_IDENT)
+  while (1)
   {
-    return parse_variable(tokenStream, pos);
-  }
+    Token tok = tokens[*pos];
+    Expr* term = NULL;
 
-  if (tok.type == TOKEN_LPAREN)
-  {
-    // Could be (expr) or (λx.expr)
-    int savePos = *pos;
-    if (tokens[savePos + 1].type == TOKEN_LAMBDA)
+    if (tok.type == TOKEN_IDENT)
     {
-        return parse_function(tokenStream, pos);
+      term = parse_variable(tokenStream, pos);
     }
-    else
+    else if (tok.type == TOKEN_LPAREN && tokens[*pos + 1].type == TOKEN_LAMBDA)
+    {
+      int param_count = parse_lambda_head(tokens, pos);
+      stack_push(groups, ((Group){ GROUP_LAMBDA, NULL, param_count }));
+      continue;
+    }
+    else if (tok.type == TOKEN_LPAREN)
     {
       (*pos)++;  // consume '('
-      Expr* inner = parse_expression(tokenStream, pos);
-      if (!inner)
+      stack_push(groups, ((Group){ GROUP_PAREN, NULL, 0 }));
+      continue;
+    }
+    else if (groups.count - base > 1)
+    {
+      // anything else has to close the innermost group
+      Group group = stack_pop(groups);
+      if (group.kind == GROUP_LAMBDA)
       {
-        report_diag(DIAG_ERROR, *pos, "Syntax Error: Invalid Expression");
+        if (!group.acc) 
+        {
+          report_diag(DIAG_ERROR, *pos, "Invalid Syntax: Empty Function Body not allowed.");
+        }
+        expect_and_consume(tokens[*pos], TOKEN_RPAREN, pos);
+
+        term = group.acc;
+        for (int i = group.param_count - 1; i >= 0; i--)
+        {
+          term = mk_abs(scope[scope_count - group.param_count + i], term);
+        }
+        scope_count -= group.param_count;
       }
-
-      if (tokens[*pos].type != TOKEN_RPAREN)
+      else
       {
-        report_diag(DIAG_ERROR, *pos, "Expected `)`");
+        if (!group.acc)
+        {
+          report_diag(DIAG_ERROR, *pos, "Syntax Error: Invalid Expression");
+        }
+        if (tokens[*pos].type != TOKEN_RPAREN)
+        {
+          report_diag(DIAG_ERROR, *pos, "Expected `)`");
+        }
+        (*pos)++;
+        term = group.acc;
       }
-      (*pos)++;
-      return inner;
     }
+    else
+    {
+      break; // end of the expression
+    }
+
+    // Create an application node - parse application
+    Group* top = &stack_top(groups);
+    top->acc = top->acc ? mk_app(top->acc, term) : term;  // left associative
   }
-  return NULL;
+
+  return stack_pop(groups).acc;
 }
 
 Expr* parse_definition(TokenStream tokens, int* pos)
@@ -145,12 +205,11 @@ Expr* parse_definition(TokenStream tokens, int* pos)
   if (tokens.tokens[*pos].type != TOKEN_IDENT) return NULL;
   
 
-  char* name = strdup(tokens.tokens[*pos].value);
+  Symbol name = token_symbol(tokens.tokens[*pos]);
   (*pos)++;
 
   if (tokens.tokens[*pos].type != TOKEN_DEF)
   {
-    free(name);
     report_diag(DIAG_ERROR, *pos, "Syntax Error: Expected `:=` after identifier in definition");
   }
   (*pos)++;
@@ -158,12 +217,10 @@ Expr* parse_definition(TokenStream tokens, int* pos)
   Expr* value = parse_expression(tokens, pos);
   if (!value) 
   {
-    free(name);
     report_diag(DIAG_ERROR, *pos, "Syntax Error: Invalid expression after `:=` in definition");
   }
 
-  Expr* def = malloc(sizeof(Expr));
-  def->type = EXPR_DEF; 
+  Expr* def = alloc_expr(EXPR_DEF);
   def->def.name = name;
   def->def.value = value;
 
@@ -173,9 +230,8 @@ Expr* parse_definition(TokenStream tokens, int* pos)
 Expr* parse_import(TokenStream tokens, int* pos)
 {
   Token token = tokens.tokens[*pos];
-  Expr* expr = malloc(sizeof(Expr));
-  expr->type = EXPR_IMPORT;
-  expr->impt.filename = token.value;
+  Expr* expr = alloc_expr(EXPR_IMPORT);
+  expr->impt.filename = alloc_name(token.text, token.length);
   return expr;
 }
 
@@ -197,59 +253,6 @@ Expr* parse_expression(TokenStream tokens, int* pos)
     return parse_import(tokens, pos);
   }
 
-  // parse Primary expr 
-  Expr* expr = parse_primary(tokens, pos);
-  if (!expr) 
-  {
-    // ignore empty expressions like return and new line
-    return NULL;
-  }
-
-  while (1)
-  {
-    int savePos = *pos;
-    Expr* next = parse_primary(tokens, pos);
-    if (!next) 
-    {
-      *pos = savePos;
-      break;
-    }
-
-    // Create an application node - parse application
-    Expr* app = malloc(sizeof(Expr));
-    app->type = EXPR_APP;
-    app->app.func = expr;
-    app->app.arg = next;
-    expr = app;  // left associative
-  }
-  
-  return expr;
-}
-
-
-void free_expr(Expr* e)
-{
-  if (!e) return;
-
-  switch (e->type) {
-    case EXPR_VAR:
-      free(e->var.name);
-      break;
-    case EXPR_DEF:
-      free(e->def.name);
-      free_expr(e->def.value);
-      break;
-    case EXPR_ABS:
-      free(e->abs.param);
-      free_expr(e->abs.body);
-      break;
-    case EXPR_APP:
-      free_expr(e->app.func);
-      free_expr(e->app.arg);
-      break;
-    case EXPR_IMPORT:
-      break;
-  }
-
-  free(e);
+  // ignore empty expressions like return and new line
+  return parse_application(tokens, pos);
 }
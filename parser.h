@@ -2,41 +2,62 @@
 #define PARSER_H
 
 #include "lexer.h"
+#include "arena.h"
+
+#include <stdbool.h>
 
 typedef enum
 {
   EXPR_VAR,   // <name>
   EXPR_ABS,   // <function>
   EXPR_APP,   // <application>
+  EXPR_NUM,   // Church numeral held as an integer, see numeral.h
   EXPR_DEF,   // <assignment>
   EXPR_IMPORT // <import>
 } ExprType;
 
 typedef struct Expr Expr;
 
+// A hash-consed node's position in the node pool, children are held as ids
+typedef uint32_t NodeId;
+
 // Variable (name)
+// Bound variables are stored nameless as a De Bruijn index, the number of
+// binders between the occurrence and its lambda (0 = innermost).
+// Free variables (globals) have index -1 and keep their name for lookup.
 typedef struct
 {
-  char* name;
+  Symbol name;
+  int index;
 } Var;
 
 // Abstraction (function)
+// `param` is only a hint used to restore names when printing
 typedef struct
 {
-  char* param;
-  Expr* body;
+  Symbol param;
+  NodeId body;
 } Abs;
 
 // Application 
 typedef struct
 {
-  Expr* func;
-  Expr* arg;
+  NodeId func;
+  NodeId arg;
 } App;
 
+// Numeral, never produced by the parser
+// `succ` and `zero` are the binder hints of its lambda form
+typedef struct
+{
+  unsigned long value;
+  Symbol succ;
+  Symbol zero;
+} Num;
+
 typedef struct 
 {
-  char* name;
+  Symbol name;
   Expr* value;
 } Def;
 
@@ -45,24 +66,84 @@ typedef struct
     const char* filename;
 } ImportExpr;
 
+#define FREE_BOUND_MAX ((1u << 24) - 1)
+#define FREE_MASK_BITS 32
+#define FREE_MASK_UNKNOWN UINT32_MAX
+
+// Var, Abs, App and Num nodes are hash-consed: they are immutable and unique
+// within their region, so structurally equal terms are the same pointer
 struct Expr 
 {
-  ExprType type;
+  ExprType type : 8;
+  // Free De Bruijn indices, as seen from the top of this node
+  unsigned int free_bound : 24; // every free index is below it, 0 for a closed term, saturates
+  unsigned int hash;            // cached structural hash
+  unsigned int size;            // nodes in the term, saturates at UINT_MAX
+  uint32_t free_mask;           // bit i: index i is free, FREE_MASK_UNKNOWN past index 31
   union
   {
       Var var;
       Abs abs;
       App app;
+      Num num;
       Def def;
       ImportExpr impt;
   };
 };
 
+// The pool is one reservation, so ids and pointers convert by offset
+extern Expr* node_pool;
+
+static inline Expr* node_at(NodeId id) { return node_pool + id; }
+static inline NodeId node_id(const Expr* e) { return (NodeId)(e - node_pool); }
+
+static inline Expr* abs_body(const Expr* e) { return node_at(e->abs.body); }
+static inline Expr* app_func(const Expr* e) { return node_at(e->app.func); }
+static inline Expr* app_arg(const Expr* e) { return node_at(e->app.arg); }
+
 Expr* parse_variable(TokenStream tokens, int* pos);
-Expr* parse_function(TokenStream tokens, int* pos);
 Expr* parse_expression(TokenStream tokens, int* pos);
 Expr* parse_import(TokenStream tokens, int* pos);
 
-void free_expr(Expr* e);
+// A region owns the nodes built while it is current: pool blocks they are
+// carved from and the table that keeps them unique. Nodes of the parent
+// (longer lived) region are reused instead of being rebuilt.
+typedef struct Region
+{
+  Arena arena;            // definitions, imports and names
+  uint32_t* blocks;       // pool blocks holding its nodes, the last one is being filled
+  size_t block_count;
+  size_t block_capacity;
+  // Table as parallel arrays, probes read hashes and only touch a node on a match
+  unsigned int* slot_hash;
+  NodeId* slot_node;      // id + 1, 0 for an empty slot
+  size_t capacity;
+  size_t count;           // nodes in the region
+  size_t allocated;       // nodes created, kept across resets
+  struct Region* parent;
+} Region;
+
+void set_expr_region(Region* region);
+Region* get_expr_region(void);
+bool region_owns(Region* region, Expr* e); // e lives in region or a parent
+void reset_region(Region* region);         // drops every node, keeps the memory
+size_t region_size(const Region* region);  // bytes its nodes take, see hashcons.c
+void free_region(Region* region);          // releases the memory as well
+
+// Copy of e in the current region when it lives in `from`, for a collector
+// that moves the live terms out before dropping `from`. Moved nodes forward
+// to their copy, so shared subterms are copied once and every root can be
+// passed in turn. `from` is only fit to be freed afterwards.
+Expr* region_evacuate(Region* from, Expr* e);
+
+Expr* mk_var(int index);
+Expr* mk_free(Symbol name);
+Expr* mk_abs(Symbol param, Expr* body);
+Expr* mk_app(Expr* func, Expr* arg);
+Expr* mk_num(unsigned long value, Symbol succ, Symbol zero);
+
+// Definitions and imports are not shared
+Expr* alloc_expr(ExprType type);
+char* alloc_name(const char* name, size_t len);
 
 #endif // PARSER_H
@@ -0,0 +1,297 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "spawn.h"
+#include "budget.h"
+#include "stats.h"
+#include "stack.h"
+#include "trace.h"
+
+// Shared with every forked worker
+typedef struct {
+    atomic_int free_workers;
+    atomic_int cheap_jobs;  // workers in this expression that did not pay for their fork
+} SpawnShared;
+
+static SpawnShared* shared = NULL;
+static unsigned long steps_at_start = 0; // in a worker, budget_steps() when it started
+
+typedef struct {
+    uint32_t ok;          // a value follows
+    uint32_t flag;
+    uint64_t steps;
+    Stats stats;
+    uint64_t node_count;
+} SpawnHeader;
+
+// VAR: a = De Bruijn index (-1 for free), b = symbol
+// ABS: a = symbol, b = body node
+// APP: a = function node, b = argument node
+// NUM: a = succ symbol, b = zero symbol, n = value
+typedef struct {
+    uint32_t type;
+    uint32_t a;
+    uint32_t b;
+    uint64_t n;
+} SpawnNode;
+
+void set_spawn_workers(int workers)
+{
+    if (!shared) {
+        shared = mmap(NULL, sizeof(SpawnShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (shared == MAP_FAILED) {
+            shared = NULL;
+            return;
+        }
+    }
+    atomic_store(&shared->free_workers, workers);
+    atomic_store(&shared->cheap_jobs, 0);
+}
+
+bool spawn_worth(const Expr* func, const Expr* arg)
+{
+    // the trace flush thread does not survive a fork
+    return shared && !trace_enabled && func->size >= SPAWN_MIN_SIZE && arg->size >= SPAWN_MIN_SIZE &&
+           atomic_load_explicit(&shared->cheap_jobs, memory_order_relaxed) < SPAWN_MAX_CHEAP &&
+           atomic_load_explicit(&shared->free_workers, memory_order_relaxed) > 0;
+}
+
+void spawn_rearm(void)
+{
+    if (shared) atomic_store(&shared->cheap_jobs, 0);
+}
+
+static bool claim_worker(void)
+{
+    int n = atomic_load(&shared->free_workers);
+    while (n > 0) {
+        if (atomic_compare_exchange_weak(&shared->free_workers, &n, n - 1)) return true;
+    }
+    return false;
+}
+
+int spawn_start(Spawned* job)
+{
+    if (!shared || !claim_worker()) return -1;
+
+    job->result = tmpfile();
+    fflush(stdout); // or the worker writes the pending output again
+    job->pid = job->result ? fork() : -1;
+    if (job->pid < 0) {
+        if (job->result) fclose(job->result);
+        atomic_fetch_add(&shared->free_workers, 1);
+        return -1;
+    }
+    if (job->pid == 0) {
+        steps_at_start = budget_steps();
+        reset_stats();
+        return 0;
+    }
+    return 1;
+}
+
+typedef struct {
+    const Expr* node;
+    bool expanded;
+} SendFrame;
+
+static struct { SendFrame* items; size_t count; size_t capacity; } send_work = {0};
+
+// Node -> index of everything sent so far, open addressing
+typedef struct {
+    const Expr** keys;
+    uint32_t* values;
+    size_t capacity;
+    size_t count;
+} NodeIndex;
+
+static size_t index_slot(const NodeIndex* map, const Expr* node)
+{
+    size_t mask = map->capacity - 1;
+    size_t i = (node->hash * 2654435769u) & mask;
+    while (map->keys[i] && map->keys[i] != node) i = (i + 1) & mask;
+    return i;
+}
+
+static bool index_find(const NodeIndex* map, const Expr* node, uint32_t* index)
+{
+    if (map->capacity == 0) return false;
+    size_t slot = index_slot(map, node);
+    if (!map->keys[slot]) return false;
+    *index = map->values[slot];
+    return true;
+}
+
+static void index_add(NodeIndex* map, const Expr* node, uint32_t index)
+{
+    if ((map->count + 1) * 2 > map->capacity) {
+        NodeIndex grown = { .capacity = map->capacity ? map->capacity * 2 : 1024, .count = map->count };
+        grown.keys = calloc(grown.capacity, sizeof(Expr*));
+        grown.values = malloc(grown.capacity * sizeof(uint32_t));
+        if (!grown.keys || !grown.values) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        for (size_t i = 0; i < map->capacity; i++) {
+            if (!map->keys[i]) continue;
+            size_t slot = index_slot(&grown, map->keys[i]);
+            grown.keys[slot] = map->keys[i];
+            grown.values[slot] = map->values[i];
+        }
+        free(map->keys);
+        free(map->values);
+        *map = grown;
+    }
+    size_t slot = index_slot(map, node);
+    map->keys[slot] = node;
+    map->values[slot] = index;
+    map->count++;
+}
+
+// Write the nodes of value in post-order, shared subterms once
+static bool send_value(FILE* out, const Expr* value, uint64_t* count)
+{
+    NodeIndex sent = {0};
+    bool ok = true;
+    stack_push(send_work, ((SendFrame){ value, false }));
+
+    while (send_work.count > 0 && ok) {
+        SendFrame frame = stack_pop(send_work);
+        const Expr* node = frame.node;
+        uint32_t known;
+        if (index_find(&sent, node, &known)) continue;
+
+        if (!frame.expanded && (node->type == EXPR_ABS || node->type == EXPR_APP)) {
+            stack_push(send_work, ((SendFrame){ node, true }));
+            if (node->type == EXPR_ABS) {
+                stack_push(send_work, ((SendFrame){ abs_body(node), false }));
+            } else {
+                stack_push(send_work, ((SendFrame){ app_arg(node), false }));
+                stack_push(send_work, ((SendFrame){ app_func(node), false }));
+            }
+            continue;
+        }
+
+        SpawnNode record = { node->type, 0, 0, 0 };
+        switch (node->type) {
+            case EXPR_VAR:
+                record.a = (uint32_t)node->var.index;
+                record.b = node->var.name;
+                break;
+            case EXPR_ABS:
+                record.a = node->abs.param;
+                index_find(&sent, abs_body(node), &record.b);
+                break;
+            case EXPR_APP:
+                index_find(&sent, app_func(node), &record.a);
+                index_find(&sent, app_arg(node), &record.b);
+                break;
+            case EXPR_NUM:
+                record.a = node->num.succ;
+                record.b = node->num.zero;
+                record.n = node->num.value;
+                break;
+            default:
+                ok = false;
+        }
+        index_add(&sent, node, (uint32_t)sent.count);
+        ok = ok && fwrite(&record, sizeof(record), 1, out) == 1;
+    }
+
+    send_work.count = 0;
+    *count = sent.count;
+    free(sent.keys);
+    free(sent.values);
+    return ok;
+}
+
+void spawn_finish(Spawned* job, Expr* value, bool flag)
+{
+    SpawnHeader header = {
+        .ok = value != NULL,
+        .flag = flag,
+        .steps = budget_steps() - steps_at_start,
+        .stats = stats,
+    };
+    FILE* out = job->result;
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              (!value || send_value(out, value, &header.node_count));
+
+    // the node count is only known now
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = fflush(out) == 0 && ok;
+    fflush(stdout);
+    _exit(ok ? 0 : 1);
+}
+
+static Expr* receive_value(FILE* in, uint64_t count)
+{
+    Expr** built = malloc((count ? count : 1) * sizeof(Expr*));
+    if (!built) return NULL;
+
+    bool ok = count > 0;
+    SpawnNode n;
+    for (uint64_t i = 0; ok && i < count; i++) {
+        ok = fread(&n, sizeof(n), 1, in) == 1;
+        if (!ok) break;
+        // children come before their parents, so every index is checked against i
+        switch (n.type) {
+            case EXPR_VAR:
+                built[i] = (int32_t)n.a < 0 ? mk_free(n.b) : mk_var((int32_t)n.a);
+                break;
+            case EXPR_ABS:
+                ok = n.b < i;
+                if (ok) built[i] = mk_abs(n.a, built[n.b]);
+                break;
+            case EXPR_APP:
+                ok = n.a < i && n.b < i;
+                if (ok) built[i] = mk_app(built[n.a], built[n.b]);
+                break;
+            case EXPR_NUM:
+                built[i] = mk_num(n.n, n.a, n.b);
+                break;
+            default:
+                ok = false;
+        }
+    }
+
+    Expr* value = ok ? built[count - 1] : NULL;
+    free(built);
+    return value;
+}
+
+Expr* spawn_join(Spawned* job, bool* flag)
+{
+    int status;
+    bool exited = waitpid(job->pid, &status, 0) == job->pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    atomic_fetch_add(&shared->free_workers, 1);
+
+    Expr* value = NULL;
+    SpawnHeader header;
+    rewind(job->result);
+    if (exited && fread(&header, sizeof(header), 1, job->result) == 1) {
+        stats.beta += header.stats.beta;
+        stats.delta += header.stats.delta;
+        stats.alpha += header.stats.alpha;
+        stats.eta += header.stats.eta;
+        stats.arith += header.stats.arith;
+        stats.allocated += header.stats.allocated;
+        stats.copied += header.stats.copied;
+        stats.collections += header.stats.collections;
+        stats_depth(header.stats.max_depth);
+        if (header.steps < SPAWN_MIN_STEPS) atomic_fetch_add(&shared->cheap_jobs, 1);
+
+        // a worker that hit a limit left the budget to decide here
+        if (budget_absorb(header.steps) && header.ok) {
+            value = receive_value(job->result, header.node_count);
+            *flag = header.flag;
+        }
+    }
+    fclose(job->result);
+    return value;
+}
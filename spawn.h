@@ -0,0 +1,54 @@
+#ifndef SPAWN_H
+#define SPAWN_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "parser.h"
+
+/*
+ * Fork-join reduction of large subterms.
+ *
+ * With `Lamb -p N` up to N extra processes share the work on one
+ * expression. When the evaluator meets an application whose function and
+ * argument both have at least SPAWN_MIN_SIZE nodes and a worker is free, it
+ * forks: the child normalises the argument while the parent carries on with
+ * the function, then the parent joins before applying it. The child sends
+ * its normal form back as post-order nodes together with its counters and
+ * steps. Workers fork in turn, the free worker count is shared by the whole
+ * process tree, and where none is free the argument is simply evaluated in
+ * place.
+ *
+ * Size is a poor guess at work: shared subterms count once per occurrence,
+ * so terms that are cheap to normalise can be huge. A fork and the trip
+ * back cost about as much as a few thousand steps. A worker that took fewer
+ * than SPAWN_MIN_STEPS steps did not pay for itself. After SPAWN_MAX_CHEAP
+ * such workers, no more are started for the rest of the expression.
+ */
+
+#define SPAWN_MIN_SIZE 512
+#define SPAWN_MIN_STEPS 10000
+#define SPAWN_MAX_CHEAP 4
+
+typedef struct {
+    pid_t pid;
+    FILE* result;
+} Spawned;
+
+void set_spawn_workers(int workers);
+bool spawn_worth(const Expr* func, const Expr* arg);
+void spawn_rearm(void); // a new top-level expression starts
+
+// Like fork, 1 in the parent once a worker started, 0 in the worker and -1
+// when no worker is free
+int spawn_start(Spawned* job);
+
+// In the worker: send value (NULL if a limit stopped it) back and exit
+void spawn_finish(Spawned* job, Expr* value, bool flag);
+
+// In the parent: wait for the worker and rebuild its value, NULL if it
+// failed. Its steps count against the budget, its counters are added.
+Expr* spawn_join(Spawned* job, bool* flag);
+
+#endif // SPAWN_H
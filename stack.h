@@ -0,0 +1,25 @@
+#ifndef STACK_H
+#define STACK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Growable work stack for the explicit-stack traversals, declare one with
+// `struct { T* items; size_t count; size_t capacity; } name`
+#define stack_push(xs, x)\
+  do { \
+    if ((xs).count >= (xs).capacity) {\
+      (xs).capacity = (xs).capacity == 0 ? 256 : (xs).capacity * 2;\
+      (xs).items = realloc((xs).items, (xs).capacity * sizeof(*(xs).items));\
+      if (!(xs).items) {\
+        fprintf(stderr, "Memory allocation failed\n");\
+        exit(1);\
+      }\
+    }\
+    (xs).items[(xs).count++] = (x);\
+  } while (0)
+
+#define stack_pop(xs) ((xs).items[--(xs).count])
+#define stack_top(xs) ((xs).items[(xs).count - 1])
+
+#endif // STACK_H
@@ -0,0 +1,17 @@
+#include <stdio.h>
+
+#include "stats.h"
+
+Stats stats = {0};
+
+void reset_stats(void)
+{
+    stats = (Stats){0};
+}
+
+void print_stats(unsigned long steps, size_t term_nodes)
+{
+    printf("-- steps %lu, beta %lu, delta %lu, alpha %lu, eta %lu, arith %lu, allocated %lu, copied %lu, peak nodes %zu, max depth %zu, collections %lu\n",
+           steps, stats.beta, stats.delta, stats.alpha, stats.eta, stats.arith,
+           stats.allocated, stats.copied, term_nodes, stats.max_depth, stats.collections);
+}
@@ -0,0 +1,33 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+
+/*
+ * Work counters for the current top-level expression. They are always
+ * kept, each update is a plain increment or compare, and `Lamb --stats`
+ * prints them after every result.
+ */
+
+typedef struct {
+    unsigned long beta;
+    unsigned long delta;
+    unsigned long alpha;        // binders renamed so a printed name does not capture
+    unsigned long eta;
+    unsigned long arith;        // numeral operations computed without unfolding, not steps
+    unsigned long allocated;    // term nodes created, hash-cons hits are not counted
+    unsigned long copied;       // term nodes rebuilt by copy_expr
+    size_t max_depth;           // deepest evaluator work stack
+    unsigned long collections;  // times the evaluator's dead terms were reclaimed
+} Stats;
+
+extern Stats stats;
+
+#define stats_depth(count) do { if ((count) > stats.max_depth) stats.max_depth = (count); } while (0)
+
+void reset_stats(void);
+
+// One line of counters, `steps` and `term_nodes` come from the caller
+void print_stats(unsigned long steps, size_t term_nodes);
+
+#endif // STATS_H
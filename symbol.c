@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "symbol.h"
+#include "arena.h"
+
+#define SYMBOL_TABLE_INITIAL 256
+
+// Open addressing table from name to id, names[id] maps back.
+// Slot value 0 (SYMBOL_NONE) marks an empty slot, so ids start at 1.
+static Arena symbol_arena = {0};
+static Symbol* slots = NULL;
+static size_t slot_capacity = 0;
+static const char** names = NULL;
+static size_t name_count = 1;
+static size_t name_capacity = 0;
+
+static uint32_t hash_name(const char* name, size_t len)
+{
+    uint32_t h = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void grow_slots(void)
+{
+    size_t capacity = slot_capacity == 0 ? SYMBOL_TABLE_INITIAL : slot_capacity * 2;
+    Symbol* grown = calloc(capacity, sizeof(Symbol));
+    if (!grown) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < slot_capacity; i++) {
+        Symbol sym = slots[i];
+        if (sym == SYMBOL_NONE) continue;
+        size_t j = hash_name(names[sym], strlen(names[sym])) & (capacity - 1);
+        while (grown[j] != SYMBOL_NONE) j = (j + 1) & (capacity - 1);
+        grown[j] = sym;
+    }
+
+    free(slots);
+    slots = grown;
+    slot_capacity = capacity;
+}
+
+Symbol intern(const char* name, size_t len)
+{
+    if (name_count * 2 >= slot_capacity) grow_slots();
+
+    size_t i = hash_name(name, len) & (slot_capacity - 1);
+    while (slots[i] != SYMBOL_NONE) {
+        const char* existing = names[slots[i]];
+        if (strncmp(existing, name, len) == 0 && existing[len] == '\0') return slots[i];
+        i = (i + 1) & (slot_capacity - 1);
+    }
+
+    if (name_count >= name_capacity) {
+        name_capacity = name_capacity == 0 ? SYMBOL_TABLE_INITIAL : name_capacity * 2;
+        names = realloc(names, name_capacity * sizeof(*names));
+        if (!names) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+    }
+
+    char* copy = arena_alloc(&symbol_arena, len + 1);
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+
+    Symbol sym = (Symbol)name_count++;
+    names[sym] = copy;
+    slots[i] = sym;
+    return sym;
+}
+
+Symbol intern_cstr(const char* name)
+{
+    return intern(name, strlen(name));
+}
+
+const char* symbol_name(Symbol sym)
+{
+    return sym != SYMBOL_NONE && sym < name_count ? names[sym] : "";
+}
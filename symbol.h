@@ -0,0 +1,16 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Interned identifier, two symbols are the same name iff their ids are equal
+typedef uint32_t Symbol;
+
+#define SYMBOL_NONE 0
+
+Symbol intern(const char* name, size_t len);
+Symbol intern_cstr(const char* name);
+const char* symbol_name(Symbol sym);
+
+#endif // SYMBOL_H
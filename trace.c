@@ -0,0 +1,162 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "trace.h"
+
+#define TRACE_CAPACITY (1u << 16) // events, a power of two
+#define TRACE_IDLE_NS 1000000     // how long the flush thread sleeps on an empty ring
+
+bool trace_enabled = false;
+
+static TraceEvent ring[TRACE_CAPACITY];
+static atomic_size_t head;   // next slot the evaluator writes
+static atomic_size_t tail;   // next slot the flush thread writes out
+static atomic_bool stopping;
+static pthread_t flusher;
+static FILE* trace_file = NULL;
+static uint32_t expression = 0;
+
+static void* flush_main(void* arg)
+{
+    (void)arg;
+    const struct timespec idle = { 0, TRACE_IDLE_NS };
+
+    for (;;) {
+        // read stopping first, every event is published before it is set
+        bool stop = atomic_load(&stopping);
+        size_t t = atomic_load_explicit(&tail, memory_order_relaxed);
+        size_t h = atomic_load_explicit(&head, memory_order_acquire);
+        if (t == h) {
+            if (stop) break;
+            nanosleep(&idle, NULL);
+            continue;
+        }
+
+        // write the contiguous run up to the end of the ring
+        size_t start = t & (TRACE_CAPACITY - 1);
+        size_t count = h - t;
+        if (start + count > TRACE_CAPACITY) count = TRACE_CAPACITY - start;
+        fwrite(&ring[start], sizeof(TraceEvent), count, trace_file);
+        atomic_store_explicit(&tail, t + count, memory_order_release);
+    }
+    fflush(trace_file);
+    return NULL;
+}
+
+bool trace_open(const char* path)
+{
+    if (trace_file) return true;
+
+    trace_file = fopen(path, "wb");
+    if (!trace_file) return false;
+
+    TraceHeader header = { .event_size = sizeof(TraceEvent) };
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    fwrite(&header, sizeof(header), 1, trace_file);
+
+    atomic_store(&stopping, false);
+    if (pthread_create(&flusher, NULL, flush_main, NULL) != 0) {
+        fclose(trace_file);
+        trace_file = NULL;
+        return false;
+    }
+    trace_enabled = true;
+    atexit(trace_close);
+    return true;
+}
+
+void trace_close(void)
+{
+    if (!trace_file) return;
+
+    trace_enabled = false;
+    atomic_store(&stopping, true);
+    pthread_join(flusher, NULL);
+    fclose(trace_file);
+    trace_file = NULL;
+}
+
+void trace_next_expression(void)
+{
+    expression++;
+}
+
+static void trace_push(TraceEvent event)
+{
+    size_t h = atomic_load_explicit(&head, memory_order_relaxed);
+    while (h - atomic_load_explicit(&tail, memory_order_acquire) == TRACE_CAPACITY) {
+        sched_yield(); // full, let the flush thread catch up
+    }
+
+    ring[h & (TRACE_CAPACITY - 1)] = event;
+    atomic_store_explicit(&head, h + 1, memory_order_release);
+}
+
+void trace_event(ReductionType rule, const Expr* term)
+{
+    trace_push((TraceEvent){
+        .rule = (uint8_t)rule,
+        .expression = expression,
+        .size = term ? term->size : 0,
+        .hash = term ? term->hash : 0,
+        .term = (uint64_t)(uintptr_t)term,
+    });
+}
+
+void trace_collection(size_t live)
+{
+    trace_push((TraceEvent){
+        .rule = TRACE_COLLECTION,
+        .expression = expression,
+        .size = live > UINT32_MAX ? UINT32_MAX : (uint32_t)live,
+    });
+}
+
+static const char* rule_name(uint8_t rule)
+{
+    switch (rule) {
+        case REDUCTION_BETA: return "beta";
+        case REDUCTION_DELTA: return "delta";
+        case CONVERSION_ALPHA: return "alpha";
+        case REDUCTION_ETA: return "eta";
+        case REDUCTION_ARITH: return "arith";
+        default: return "other";
+    }
+}
+
+bool trace_decode(const char* path, FILE* out)
+{
+    FILE* in = fopen(path, "rb");
+    if (!in) return false;
+
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.event_size != sizeof(TraceEvent)) {
+        fclose(in);
+        return false;
+    }
+
+    TraceEvent events[1024];
+    size_t count;
+    unsigned long step = 0;
+    while ((count = fread(events, sizeof(TraceEvent), 1024, in)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            const TraceEvent* e = &events[i];
+            if (e->rule == TRACE_COLLECTION) {
+                // not a step, term addresses before it may be reused after it
+                fprintf(out, "-\texpr %u\tcollect\tlive %u\n", e->expression, e->size);
+                continue;
+            }
+            fprintf(out, "%lu\texpr %u\t%s\tterm %#llx\tsize %u\thash %08x\n",
+                    ++step, e->expression, rule_name(e->rule),
+                    (unsigned long long)e->term, e->size, e->hash);
+        }
+    }
+    fclose(in);
+    return true;
+}
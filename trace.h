@@ -0,0 +1,58 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "debug.h"
+
+/*
+ * Binary reduction trace.
+ *
+ * While a trace is open, log_reduction appends one fixed size event per
+ * beta, delta, alpha, eta or arith step to a ring buffer in memory. A flush thread
+ * drains the ring into the trace file, so the evaluator never formats or
+ * writes anything itself. The evaluator is the only producer and the flush
+ * thread the only consumer, so head and tail are plain atomics without a
+ * lock. When the ring is full the evaluator yields until there is room, a
+ * trace is never missing events.
+ *
+ * The file is a TraceHeader followed by TraceEvents in host byte order,
+ * trace_decode renders one as text.
+ *
+ * The term of an event is its node address. The copying collector moves
+ * live terms and reuses the blocks it frees, so an address only names one
+ * term between two collections. Each collection is logged as a
+ * TRACE_COLLECTION event to mark where addresses start over.
+ */
+
+#define TRACE_MAGIC "LAMBTRC1"
+#define TRACE_COLLECTION 0xff // rule of a collection event, size is the live nodes
+
+typedef struct {
+    char magic[8];
+    uint32_t event_size;
+    uint32_t reserved;
+} TraceHeader;
+
+typedef struct {
+    uint8_t rule;        // ReductionType
+    uint8_t reserved[3];
+    uint32_t expression; // top-level expression, counted from 1
+    uint32_t size;       // nodes in the term
+    uint32_t hash;       // structural hash of the term
+    uint64_t term;       // node address, unique up to the next collection, 0 for none
+} TraceEvent;
+
+extern bool trace_enabled;
+
+bool trace_open(const char* path);  // starts the flush thread, flushed at exit
+void trace_close(void);
+void trace_next_expression(void);
+void trace_event(ReductionType rule, const Expr* term);
+void trace_collection(size_t live);
+
+// Print a trace file as text, false if it is not a trace
+bool trace_decode(const char* path, FILE* out);
+
+#endif // TRACE_H
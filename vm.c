@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vm.h"
+#include "budget.h"
+#include "stats.h"
+#include "diagnostics.h"
+#include "debug.h"
+#include "stack.h"
+
+typedef struct {
+    int32_t pc;
+    VmEnv* env;
+} CallFrame;
+
+// Code lives until the next top-level expression, values as long as the region
+static Chunk chunk = {0};
+static struct { VmValue** items; size_t count; size_t capacity; } values = {0};
+static struct { CallFrame* items; size_t count; size_t capacity; } frames = {0};
+
+static VmValue* new_value(VmValueKind kind)
+{
+    VmValue* value = arena_alloc(&get_expr_region()->arena, sizeof(VmValue));
+    value->kind = kind;
+    return value;
+}
+
+static VmEnv* extend(VmValue* value, VmEnv* env)
+{
+    VmEnv* entry = arena_alloc(&get_expr_region()->arena, sizeof(VmEnv));
+    entry->value = value;
+    entry->next = env;
+    return entry;
+}
+
+// Run code from pc until the block it started in returns
+static VmValue* run(int32_t pc, VmEnv* env, Env* globals)
+{
+    size_t frame_base = frames.count;
+    size_t value_base = values.count;
+
+    for (;;) {
+        int32_t* code = chunk.code.items; // compiling a global may move the buffer
+        switch (code[pc]) {
+            case OP_ACCESS:
+            {
+                VmEnv* entry = env;
+                for (int32_t i = code[pc + 1]; i > 0; i--) entry = entry->next;
+                stack_push(values, entry->value);
+                pc += 2;
+                break;
+            }
+            case OP_CLOSURE:
+            {
+                VmValue* closure = new_value(VM_CLOSURE);
+                closure->closure.code = pc + 3;
+                closure->closure.abs = code[pc + 1];
+                closure->closure.env = env;
+                stack_push(values, closure);
+                pc += 3 + code[pc + 2];
+                break;
+            }
+            case OP_GLOBAL:
+            {
+                Symbol name = (Symbol)code[pc + 1];
+                Expr* def = env_lookup(globals, name);
+                if (!def) {
+                    VmValue* free_var = new_value(VM_FREE);
+                    free_var->name = name;
+                    stack_push(values, free_var);
+                    pc += 2;
+                    break;
+                }
+                if (!budget_spend()) {
+                    frames.count = frame_base;
+                    values.count = value_base;
+                    return NULL;
+                }
+                log_reduction(REDUCTION_DELTA, "expanding", def);
+                int32_t entry = compile_term(&chunk, def);
+                stack_push(frames, ((CallFrame){ pc + 2, env }));
+                env = NULL; // definitions are closed
+                pc = entry;
+                break;
+            }
+            case OP_APPLY:
+            case OP_TAILAPPLY:
+            {
+                VmValue* arg = stack_pop(values);
+                VmValue* func = stack_pop(values);
+                if (func->kind != VM_CLOSURE) {
+                    VmValue* app = new_value(VM_APP);
+                    app->app.func = func;
+                    app->app.arg = arg;
+                    stack_push(values, app);
+                    pc += 1;
+                    break;
+                }
+                if (!budget_spend()) {
+                    frames.count = frame_base;
+                    values.count = value_base;
+                    return NULL;
+                }
+                log_reduction(REDUCTION_BETA, "entering", chunk.abstractions.items[func->closure.abs]);
+                if (code[pc] == OP_APPLY) stack_push(frames, ((CallFrame){ pc + 1, env }));
+                env = extend(arg, func->closure.env);
+                pc = func->closure.code;
+                break;
+            }
+            case OP_RETURN:
+            {
+                if (frames.count == frame_base) return stack_pop(values);
+                stats_depth(frames.count);
+                CallFrame frame = stack_pop(frames);
+                pc = frame.pc;
+                env = frame.env;
+                break;
+            }
+            default:
+                report_interp(DIAG_ERROR, "Invalid bytecode");
+        }
+    }
+}
+
+typedef struct {
+    VmValue* value;  // value to read back, or NULL to build from results
+    Expr* abs;       // when building: abstraction to rebuild, NULL for an application
+    int depth;
+} ReadFrame;
+
+static struct { ReadFrame* items; size_t count; size_t capacity; } read_work = {0};
+static struct { Expr** items; size_t count; size_t capacity; } read_results = {0};
+
+static Expr* readback(VmValue* value, Env* globals)
+{
+    if (!value) return NULL;
+
+    size_t base = read_work.count;
+    size_t results_base = read_results.count;
+    stack_push(read_work, ((ReadFrame){ value, NULL, 0 }));
+
+    while (read_work.count > base) {
+        ReadFrame frame = stack_pop(read_work);
+
+        if (!frame.value) {
+            if (frame.abs) {
+                Expr* body = stack_pop(read_results);
+                stack_push(read_results, mk_abs(frame.abs->abs.param, body));
+            } else {
+                Expr* arg = stack_pop(read_results);
+                Expr* func = stack_pop(read_results);
+                stack_push(read_results, mk_app(func, arg));
+            }
+            continue;
+        }
+
+        VmValue* current = frame.value;
+        switch (current->kind) {
+            case VM_CLOSURE:
+            {
+                // normalise under the binder by applying to a fresh variable
+                VmValue* var = new_value(VM_LEVEL);
+                var->level = frame.depth;
+                VmValue* body = run(current->closure.code, extend(var, current->closure.env), globals);
+                if (!body) {
+                    // a limit tripped while normalising under the binder
+                    read_work.count = base;
+                    read_results.count = results_base;
+                    return NULL;
+                }
+                Expr* abs = chunk.abstractions.items[current->closure.abs];
+                stack_push(read_work, ((ReadFrame){ NULL, abs, frame.depth }));
+                stack_push(read_work, ((ReadFrame){ body, NULL, frame.depth + 1 }));
+                break;
+            }
+            case VM_LEVEL:
+                stack_push(read_results, mk_var(frame.depth - 1 - current->level));
+                break;
+            case VM_FREE:
+                stack_push(read_results, mk_free(current->name));
+                break;
+            case VM_APP:
+                stack_push(read_work, ((ReadFrame){ NULL, NULL, frame.depth }));
+                stack_push(read_work, ((ReadFrame){ current->app.arg, NULL, frame.depth }));
+                stack_push(read_work, ((ReadFrame){ current->app.func, NULL, frame.depth }));
+                break;
+        }
+    }
+
+    return stack_pop(read_results);
+}
+
+Expr* vm_normalise(Expr* expr, Env* globals)
+{
+    reset_chunk(&chunk); // globals may have been redefined since the last run
+
+    int32_t entry = compile_term(&chunk, expr);
+    Expr* result = readback(run(entry, NULL, globals), globals);
+
+#ifdef LOGGING
+    disassemble(&chunk);
+#endif
+    return result;
+}
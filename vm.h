@@ -0,0 +1,43 @@
+#ifndef VM_H
+#define VM_H
+
+#include "bytecode.h"
+#include "interpreter.h"
+
+/*
+ * Stack based virtual machine running the bytecode from bytecode.h.
+ *
+ * Like the closure machine it evaluates call-by-value to closures over
+ * linked environments, but it dispatches over contiguous instructions
+ * instead of walking the Expr tree. Results are read back into an Expr
+ * for printing by running each closure body on a fresh neutral variable.
+ */
+
+typedef struct VmValue VmValue;
+
+typedef struct VmEnv {
+    VmValue* value;
+    struct VmEnv* next;
+} VmEnv;
+
+typedef enum {
+    VM_CLOSURE,
+    VM_LEVEL,
+    VM_FREE,
+    VM_APP,
+} VmValueKind;
+
+struct VmValue {
+    VmValueKind kind;
+    union {
+        struct { int32_t code; int32_t abs; VmEnv* env; } closure;
+        int level;
+        Symbol name;
+        struct { VmValue* func; VmValue* arg; } app;
+    };
+};
+
+// Evaluate a closed top-level expression to its normal form
+Expr* vm_normalise(Expr* expr, Env* globals);
+
+#endif // VM_H